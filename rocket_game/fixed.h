@@ -0,0 +1,91 @@
+// Q16.16 fixed point
+// Signed 32-bit numbers with 16 fractional bits, for game physics on the ESP32-S3, whose FPU
+// only does single precision and leaves every double to software routines. Every operation
+// saturates: a result out of range sticks at FIXED_MAX or FIXED_MIN instead of wrapping round
+// to the other sign. Conversions to int truncate toward zero, as assigning a double to an int
+// does, and fixedRound() rounds halves away from zero like round().
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stdint.h>
+
+typedef int32_t fixed;
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE ((fixed)1 << FIXED_SHIFT)
+#define FIXED_MAX INT32_MAX
+#define FIXED_MIN INT32_MIN
+
+// Nearest fixed to a constant, worked out by the compiler so no double reaches the board
+constexpr fixed fixedConst(double value) {
+  return (fixed)(value * FIXED_ONE + (value < 0 ? -0.5 : 0.5));
+}
+
+// The fixed just below or just above a constant that has no exact one, such as 0.1, for sums
+// that have to err on a known side
+constexpr fixed fixedConstBelow(double value) {
+  return (fixed)(value * FIXED_ONE) - ((fixed)(value * FIXED_ONE) > value * FIXED_ONE);
+}
+
+constexpr fixed fixedConstAbove(double value) {
+  return (fixed)(value * FIXED_ONE) + ((fixed)(value * FIXED_ONE) < value * FIXED_ONE);
+}
+
+inline fixed fixedSaturate(int64_t value) {
+  return value > FIXED_MAX ? FIXED_MAX : value < FIXED_MIN ? FIXED_MIN : (fixed)value;
+}
+
+inline fixed fixedFromInt(int32_t n) {
+  return fixedSaturate((int64_t)n << FIXED_SHIFT);
+}
+
+inline int32_t fixedToInt(fixed a) {
+  return a >= 0 ? a >> FIXED_SHIFT : -(int32_t)(-(int64_t)a >> FIXED_SHIFT);
+}
+
+inline int32_t fixedRound(fixed a) {
+  int64_t half = FIXED_ONE / 2;
+  return a >= 0 ? (int32_t)(((int64_t)a + half) >> FIXED_SHIFT) : -(int32_t)((-(int64_t)a + half) >> FIXED_SHIFT);
+}
+
+inline float fixedToFloat(fixed a) {
+  return a * (1.0f / FIXED_ONE);
+}
+
+inline fixed fixedAdd(fixed a, fixed b) {
+  return fixedSaturate((int64_t)a + b);
+}
+
+inline fixed fixedSub(fixed a, fixed b) {
+  return fixedSaturate((int64_t)a - b);
+}
+
+// Rounded to the nearest, halves up
+inline fixed fixedMul(fixed a, fixed b) {
+  return fixedSaturate(((int64_t)a * b + FIXED_ONE / 2) >> FIXED_SHIFT);
+}
+
+inline fixed fixedMulInt(fixed a, int32_t n) {
+  return fixedSaturate((int64_t)a * n);
+}
+
+// Truncated toward zero. Dividing by zero saturates to the sign of a.
+inline fixed fixedDiv(fixed a, fixed b) {
+  if (b == 0) return a < 0 ? FIXED_MIN : FIXED_MAX;
+  return fixedSaturate(((int64_t)a << FIXED_SHIFT) / b);
+}
+
+inline fixed fixedDivInt(fixed a, int32_t n) {
+  if (n == 0) return a < 0 ? FIXED_MIN : FIXED_MAX;
+  return fixedSaturate((int64_t)a / n);
+}
+
+inline fixed fixedMin(fixed a, fixed b) {
+  return a < b ? a : b;
+}
+
+inline fixed fixedMax(fixed a, fixed b) {
+  return a > b ? a : b;
+}
+
+#endif
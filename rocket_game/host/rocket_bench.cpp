@@ -0,0 +1,458 @@
+// Rocket physics host check and benchmark
+// Runs the fixed point physics in rocket.cpp next to the sketch's original double code, kept
+// here verbatim, through flights on the same random buttons: checks each tick against the
+// double code from the same state, where each flight first parts from its double twin and the
+// flights' results against each other. Then flies scripted pilots that land, collect bonuses,
+// win and crash on both, flight by flight. Fails if they drift apart by more than the bounds
+// below. Then times a tick each way. The host has a double FPU, so the timing only shows the
+// fixed point tick costs no more; on the ESP32-S3 the doubles are software routines and the
+// gap is much wider.
+// Build from rocket_game/host:
+//   g++ -O2 -I.. rocket_bench.cpp ../rocket.cpp -o rocket_bench
+// Usage: rocket_bench [flights]
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include "rocket.h"
+
+#define GROUND 282
+#define MAX_FUEL 100
+#define FLIGHT_TICKS 3000
+#define DEFAULT_FLIGHTS 2000
+#define BENCH_TICKS 20000000
+// The sketch moves the rocket every DRAW_STEP, six times per SIMULATION_STEP
+#define MOVES_PER_TICK 6
+
+// Bounds on the drift from the double code. From the same state a tick should come out the
+// same, give or take a rare one m/s where accel's error reaches a rounding edge. The doubles
+// drift off the decimal values in their own way, so one flight can still take a different path
+// from its double twin where accel sits on an edge, such as a half for round(): the doubles'
+// error falls either side of it, accel's always the same side. A flight must part by no more
+// than one m/s, and few may part at all. Random buttons do not steer back, so once parted the
+// two play out as different flights and are held to the same results across all of them.
+// Scripted pilots do steer, and each of their flights is held to the same ending.
+#define TICK_MISMATCH_RATE 0.001
+#define TICK_MAX_DIFF 1
+#define TICK_MAX_ACCEL_DIFF 1e-3
+#define FLIGHT_MAX_RATIO 0.02
+#define FLIGHT_MAX_PARTED 0.3     // share of random flights that part from their twin
+#define SCRIPT_MAX_TICK_DIFF 10   // between the ends of a scripted flight on each
+#define SCRIPT_MAX_RATIO 0.02     // tank, fuel and altitude at the end, of the doubles' tank or altitude
+
+using std::min;
+using std::max;
+
+static double nowSeconds() {
+  using namespace std::chrono;
+  return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t nextRandom(uint32_t &state) {
+  state = state * 1664525 + 1013904223;
+  return state >> 8;
+}
+
+// The original, on doubles as the sketch had it
+struct Reference {
+  int y, ground, speed, height, fuel, max_fuel;
+  double grav, accel;
+  int lastState, completed;
+};
+
+static void referenceTick(Reference &r, int buttons) {
+  int &y = r.y, &ground = r.ground, &speed = r.speed, &fuel = r.fuel, &max_fuel = r.max_fuel;
+  double &grav = r.grav, &accel = r.accel;
+  bool left = buttons & ROCKET_THRUST, right = buttons & ROCKET_IMPULSE;
+  if (y >= ground && fuel <= max_fuel) {
+    fuel += min(10, max_fuel - fuel);
+    accel = grav;
+  }
+  if (fuel > 0 && !r.lastState && right) {
+    if (fuel < 0.10 * max_fuel) fuel = 0;
+    else fuel -= 0.10 * max_fuel;
+    speed += min(5.0, accel) * max_fuel / 20;
+    if (accel > 1) accel = max(accel-1.0, 1.0);
+  }
+  if (fuel > 0 && left) {
+    fuel -= 1;
+    if (speed < 200) speed++;
+    if (accel > 1) accel = max(accel-0.1, 1.0);
+  }
+  if (y != ground && !r.completed && (fuel <= 0 || !left)) {
+    accel += 0.02;
+    if (accel < grav) accel += 0.18;
+    speed -= round(accel);
+  }
+  if (-(y-ground) < 300) {
+    accel = grav;
+    if (speed < -16) speed += 9;
+    else if (speed < -7) speed += 2;
+    else if (speed == -7) speed++;
+  }
+  r.lastState = right;
+}
+
+static void referenceLevel(Reference &r) {
+  int y = r.y, ground = r.ground;
+  if (-(y-ground) < 300) r.grav = 1.0;
+  else if (-(y-ground) < 9900) r.grav = 3.0;
+  else if (-(y-ground) < 33300) r.grav = 2.0;
+  else r.grav = 1.0;
+}
+
+static void referenceMove(Reference &r) {
+  int &y = r.y, &ground = r.ground, &speed = r.speed, &height = r.height, &fuel = r.fuel, &max_fuel = r.max_fuel;
+  if (speed > 0) height += speed;
+  y -= speed;
+  if (y > ground) {
+    y = ground;
+    if (speed <= -7) {
+      fuel += ((6 + speed) * max_fuel)/40;
+      max_fuel += ((6 + speed) * max_fuel)/40;
+    } else if (speed < 0 && height > 100) {
+      if (speed > -3) height *= 2;
+      max_fuel += height/100;
+      fuel = max_fuel;
+    }
+    height = 0;
+    speed = 0;
+  }
+}
+
+static double toDouble(fixed a) {
+  return (double)a / FIXED_ONE;
+}
+
+static void copyState(const Rocket &rocket, Reference &r) {
+  r.y = rocket.y;
+  r.ground = rocket.ground;
+  r.speed = rocket.speed;
+  r.height = rocket.height;
+  r.fuel = rocket.fuel;
+  r.max_fuel = rocket.maxFuel;
+  r.grav = toDouble(rocket.grav);
+  r.accel = toDouble(rocket.accel);
+  r.lastState = rocket.impulseHeld;
+  r.completed = rocket.completed;
+}
+
+static bool sameState(const Rocket &rocket, const Reference &r) {
+  return rocket.y == r.y && rocket.speed == r.speed && rocket.height == r.height &&
+         rocket.fuel == r.fuel && rocket.maxFuel == r.max_fuel;
+}
+
+// Taps and holds as a player might: a button is pressed or let go now and then
+static int nextButtons(uint32_t &state, int buttons) {
+  uint32_t r = nextRandom(state);
+  if ((r & 0xff) < 24) buttons ^= ROCKET_THRUST;
+  if (((r >> 8) & 0xff) < 64) buttons ^= ROCKET_IMPULSE;
+  return buttons;
+}
+
+struct FlightStats {
+  long ticks, mismatches;
+  int speedDiff, fuelDiff;
+  double accelDiff;
+  double peaks, tanks, lengths;
+  int wins, crashes, parted;
+  long partTicks;                 // summed over the flights that part
+  int firstPart;                  // earliest tick a flight parted at
+  int partSpeedDiff, partFuelDiff; // most the two differed by on the tick they parted
+};
+
+// The sketch's ends: a win past 999 m/s, or game over once the fuel runs down to minus the tank
+static bool flightOver(int speed, int fuel, int maxFuel) {
+  return speed > 999 || fuel <= -maxFuel;
+}
+
+static void endFlight(FlightStats &stats, int ticks, int peak, int speed, int maxFuel) {
+  stats.lengths += ticks;
+  stats.peaks += peak;
+  stats.tanks += maxFuel;
+  if (speed > 999) stats.wins++;
+}
+
+// A flight on the fixed point physics, ticking, levelling and moving as the sketch does, which
+// hands the double code a copy of its state every tick to see how far one tick takes them
+// apart, and follows the double code's own flight to where it takes another path
+static void flyFixed(FlightStats &stats, uint32_t seed) {
+  Rocket rocket;
+  Reference path;
+  rocketBegin(rocket, GROUND, MAX_FUEL);
+  copyState(rocket, path);
+  bool together = true;
+  int buttons = 0, peak = 0, t = 0;
+  for (; t < FLIGHT_TICKS && !flightOver(rocket.speed, rocket.fuel, rocket.maxFuel); t++) {
+    buttons = nextButtons(seed, buttons);
+    Reference step;
+    copyState(rocket, step);
+    rocketTick(rocket, buttons);
+    referenceTick(step, buttons);
+    referenceTick(path, buttons);
+    stats.ticks++;
+    if (together && !sameState(rocket, path)) {
+      together = false;
+      stats.parted++;
+      stats.partTicks += t;
+      stats.firstPart = stats.parted == 1 ? t : min(stats.firstPart, t);
+      stats.partSpeedDiff = max(stats.partSpeedDiff, abs(rocket.speed - path.speed));
+      stats.partFuelDiff = max(stats.partFuelDiff, abs(rocket.fuel - path.fuel));
+    }
+    if (!sameState(rocket, step)) stats.mismatches++;
+    stats.speedDiff = max(stats.speedDiff, abs(rocket.speed - step.speed));
+    stats.fuelDiff = max(stats.fuelDiff, abs(rocket.fuel - step.fuel));
+    stats.accelDiff = max(stats.accelDiff, fabs(toDouble(rocket.accel) - step.accel));
+    for (int m = 0; m < MOVES_PER_TICK; m++) {
+      rocketLevel(rocket);
+      referenceLevel(path);
+      if (rocketMove(rocket) == ROCKET_CRASHED) stats.crashes++;
+      referenceMove(path);
+      peak = max(peak, rocketAltitude(rocket));
+    }
+  }
+  endFlight(stats, t, peak, rocket.speed, rocket.maxFuel);
+}
+
+// The same flight on the double code alone
+static void flyDoubles(FlightStats &stats, uint32_t seed) {
+  Reference reference;
+  Rocket start;
+  rocketBegin(start, GROUND, MAX_FUEL);
+  copyState(start, reference);
+  int buttons = 0, peak = 0, t = 0;
+  for (; t < FLIGHT_TICKS && !flightOver(reference.speed, reference.fuel, reference.max_fuel); t++) {
+    buttons = nextButtons(seed, buttons);
+    referenceTick(reference, buttons);
+    stats.ticks++;
+    for (int m = 0; m < MOVES_PER_TICK; m++) {
+      referenceLevel(reference);
+      bool falling = reference.speed <= -7;
+      referenceMove(reference);
+      if (falling && reference.speed == 0) stats.crashes++;
+      peak = max(peak, reference.ground - reference.y);
+    }
+  }
+  endFlight(stats, t, peak, reference.speed, reference.max_fuel);
+}
+
+static bool within(double a, double b, double ratio) {
+  return fabs(a - b) <= ratio * fabs(b);
+}
+
+static bool checkFlights(int flights) {
+  FlightStats fixedStats = {}, doubleStats = {};
+  for (int f = 0; f < flights; f++) {
+    flyFixed(fixedStats, f + 1);
+    flyDoubles(doubleStats, f + 1);
+  }
+
+  double rate = (double)fixedStats.mismatches / fixedStats.ticks;
+  bool ticksOk = rate <= TICK_MISMATCH_RATE && fixedStats.speedDiff <= TICK_MAX_DIFF &&
+                 fixedStats.fuelDiff <= TICK_MAX_DIFF && fixedStats.accelDiff <= TICK_MAX_ACCEL_DIFF;
+  printf("single ticks: %ld along the flights, %ld (%.3f%%) differ, by at most %d m/s, %d fuel, %.2g accel: %s\n",
+         fixedStats.ticks, fixedStats.mismatches, rate * 100, fixedStats.speedDiff, fixedStats.fuelDiff,
+         fixedStats.accelDiff, ticksOk ? "within bounds" : "OUT OF BOUNDS");
+
+  // Random buttons never win, so wins are only reported; the scripted flights check them
+  bool flightsOk = fixedStats.parted <= FLIGHT_MAX_PARTED * flights &&
+                   fixedStats.partSpeedDiff <= TICK_MAX_DIFF && fixedStats.partFuelDiff <= TICK_MAX_DIFF &&
+                   within(fixedStats.lengths, doubleStats.lengths, FLIGHT_MAX_RATIO) &&
+                   within(fixedStats.peaks, doubleStats.peaks, FLIGHT_MAX_RATIO) &&
+                   within(fixedStats.tanks, doubleStats.tanks, FLIGHT_MAX_RATIO) &&
+                   within(fixedStats.crashes, doubleStats.crashes, FLIGHT_MAX_RATIO);
+  printf("flights: %d of up to %d ticks on the same buttons, %d (%.1f%%) take another path, at tick %.1f on "
+         "average and %d at the earliest, by at most %d m/s and %d fuel: %s\n",
+         flights, FLIGHT_TICKS, fixedStats.parted, fixedStats.parted * 100.0 / flights,
+         fixedStats.parted ? (double)fixedStats.partTicks / fixedStats.parted : 0.0, fixedStats.firstPart,
+         fixedStats.partSpeedDiff, fixedStats.partFuelDiff, flightsOk ? "within bounds" : "OUT OF BOUNDS");
+  const FlightStats *stats[2] = {&doubleStats, &fixedStats};
+  const char *names[2] = {"doubles", "fixed point"};
+  for (int k = 0; k < 2; k++) {
+    printf("  %-11s %7.1f ticks, %8.0f m peak altitude, %6.1f $ tank at the end on average, %6d crashes, %5d wins\n",
+           names[k], stats[k]->lengths / flights, stats[k]->peaks / flights, stats[k]->tanks / flights, stats[k]->crashes, stats[k]->wins);
+  }
+  return ticksOk && flightsOk;
+}
+
+// How a scripted flight ended
+enum Ending { ENDING_WON, ENDING_LANDED, ENDING_OVER, ENDING_TIMEOUT };
+static const char *endingNames[] = {"won", "landed", "game over", "timed out"};
+
+// A scripted pilot: waits on the pad for a full tank, climbs on thrust until it has burnt the
+// tank down to climbTenths or reached ceiling, then coasts and brakes on the way down to touch
+// down slower than 3 m/s for a double bonus. Once the tank holds winTank it climbs on thrust
+// and impulses instead until it passes 999 m/s. Without brakes it comes down as it falls.
+struct Script {
+  const char *name;
+  int climbTenths, ceiling, winTank;
+  bool brakes;
+  int landings;   // bonus landings that end the flight, 0 to fly on
+  Ending ending;  // how the flight has to end on both
+};
+
+// What the pilot reads off either rocket
+struct Cockpit {
+  int altitude, speed, fuel, maxFuel;
+};
+
+static int scriptButtons(const Script &script, const Cockpit &c, int tick, bool &climbing) {
+  if (c.altitude == 0 && c.speed == 0) {
+    if (c.fuel < c.maxFuel) return 0;
+    climbing = true;
+  }
+  if (script.winTank > 0 && c.maxFuel >= script.winTank && climbing) {
+    return ROCKET_THRUST | (c.speed >= 150 && tick % 2 ? ROCKET_IMPULSE : 0);
+  }
+  if (climbing && (c.speed < 0 || c.fuel <= c.maxFuel * script.climbTenths / 10 || c.altitude >= script.ceiling)) {
+    climbing = false;
+  }
+  if (climbing) return ROCKET_THRUST;
+  if (!script.brakes || c.fuel <= 0) return 0;
+  // The game itself holds the speed near 7 m/s in the lowest 300 m, thrust takes it below 3
+  if (c.altitude < 300) return c.speed < -1 ? ROCKET_THRUST : 0;
+  // Thrust only stops the fall a m/s a tick, so braking starts about 6 m per m/s squared up
+  return c.speed < -2 && c.altitude < 3 * c.speed * (c.speed - 2) + 600 ? ROCKET_THRUST : 0;
+}
+
+// One side of a scripted flight
+struct ScriptFlight {
+  bool climbing, done;
+  Ending ending;
+  int ticks, bonuses, crashes;
+};
+
+static void scriptEnd(ScriptFlight &flight, const Script &script, int speed, int fuel, int maxFuel, int tick) {
+  flight.ticks = tick + 1;
+  if (speed > 999) flight.ending = ENDING_WON;
+  else if (script.landings > 0 && flight.bonuses >= script.landings) flight.ending = ENDING_LANDED;
+  else if (flightOver(speed, fuel, maxFuel)) flight.ending = ENDING_OVER;
+  else return;
+  flight.done = true;
+}
+
+// Flies the script on both side by side, each pilot reading its own rocket, and holds the two
+// to the same ending: the one the script expects, the same bonuses and crashes on the way, and
+// the ticks it took, the tank, fuel and altitude it ended with within the bounds
+static bool flyScript(const Script &script) {
+  Rocket rocket;
+  Reference reference;
+  rocketBegin(rocket, GROUND, MAX_FUEL);
+  copyState(rocket, reference);
+  ScriptFlight fixedFlight = {false, false, ENDING_TIMEOUT, FLIGHT_TICKS, 0, 0};
+  ScriptFlight doubleFlight = fixedFlight;
+  int parted = -1;
+  for (int t = 0; t < FLIGHT_TICKS && !(fixedFlight.done && doubleFlight.done); t++) {
+    if (!fixedFlight.done) {
+      Cockpit c = {rocketAltitude(rocket), rocket.speed, rocket.fuel, rocket.maxFuel};
+      rocketTick(rocket, scriptButtons(script, c, t, fixedFlight.climbing));
+      for (int m = 0; m < MOVES_PER_TICK; m++) {
+        rocketLevel(rocket);
+        RocketLanding landing = rocketMove(rocket);
+        if (landing == ROCKET_CRASHED) fixedFlight.crashes++;
+        if (landing == ROCKET_BONUS || landing == ROCKET_DOUBLE_BONUS) fixedFlight.bonuses++;
+      }
+      scriptEnd(fixedFlight, script, rocket.speed, rocket.fuel, rocket.maxFuel, t);
+    }
+    if (!doubleFlight.done) {
+      Cockpit c = {reference.ground - reference.y, reference.speed, reference.fuel, reference.max_fuel};
+      referenceTick(reference, scriptButtons(script, c, t, doubleFlight.climbing));
+      for (int m = 0; m < MOVES_PER_TICK; m++) {
+        referenceLevel(reference);
+        bool falling = reference.speed <= -7;
+        int tank = reference.max_fuel;
+        referenceMove(reference);
+        if (falling && reference.speed == 0) doubleFlight.crashes++;
+        else if (reference.max_fuel > tank) doubleFlight.bonuses++;
+      }
+      scriptEnd(doubleFlight, script, reference.speed, reference.fuel, reference.max_fuel, t);
+    }
+    if (parted < 0 && !sameState(rocket, reference)) parted = t;
+  }
+
+  double tank = fabs((double)reference.max_fuel);
+  int altitude = reference.ground - reference.y;
+  bool ok = fixedFlight.ending == script.ending && doubleFlight.ending == script.ending &&
+            fixedFlight.bonuses == doubleFlight.bonuses && fixedFlight.crashes == doubleFlight.crashes &&
+            abs(fixedFlight.ticks - doubleFlight.ticks) <= SCRIPT_MAX_TICK_DIFF &&
+            abs(rocket.maxFuel - reference.max_fuel) <= SCRIPT_MAX_RATIO * tank &&
+            abs(rocket.fuel - reference.fuel) <= SCRIPT_MAX_RATIO * tank &&
+            abs(rocketAltitude(rocket) - altitude) <= SCRIPT_MAX_RATIO * altitude;
+  char part[24];
+  if (parted < 0) snprintf(part, sizeof part, "never");
+  else snprintf(part, sizeof part, "at tick %d", parted);
+  printf("  %-10s parts %-12s %s\n", script.name, part, ok ? "within bounds" : "OUT OF BOUNDS");
+  const char *names[2] = {"doubles", "fixed point"};
+  const ScriptFlight *flights[2] = {&doubleFlight, &fixedFlight};
+  const int tanks[2] = {reference.max_fuel, rocket.maxFuel}, fuels[2] = {reference.fuel, rocket.fuel};
+  const int altitudes[2] = {altitude, rocketAltitude(rocket)};
+  for (int k = 0; k < 2; k++) {
+    printf("    %-11s %-9s after %4d ticks, %2d bonuses, %d crashes, %5d $ tank, %5d fuel, %7d m\n",
+           names[k], endingNames[flights[k]->ending], flights[k]->ticks, flights[k]->bonuses,
+           flights[k]->crashes, tanks[k], fuels[k], altitudes[k]);
+  }
+  return ok;
+}
+
+static bool checkScripts() {
+  const Script scripts[] = {
+    {"hops", 5, 5000, 0, true, 8, ENDING_LANDED},
+    {"high hops", 7, 20000, 0, true, 4, ENDING_LANDED},
+    {"race", 5, 5000, 2000, true, 0, ENDING_WON},
+    {"high race", 7, 20000, 2000, true, 0, ENDING_WON},
+    {"dive", 5, 5000, 0, false, 0, ENDING_OVER},
+  };
+  printf("scripted flights, each held to the same ending on both:\n");
+  bool ok = true;
+  for (const Script &script : scripts) ok = flyScript(script) && ok;
+  return ok;
+}
+
+// A tick's cost each way, over a flight's worth of states so the branches vary
+static void benchTicks() {
+  const int numStates = 4096;
+  static Rocket states[numStates];
+  static Reference references[numStates];
+  static int buttons[numStates];
+  Rocket rocket;
+  rocketBegin(rocket, GROUND, MAX_FUEL);
+  uint32_t random = 1;
+  int held = 0;
+  for (int k = 0; k < numStates; k++) {
+    held = nextButtons(random, held);
+    buttons[k] = held;
+    states[k] = rocket;
+    copyState(rocket, references[k]);
+    rocketTick(rocket, held);
+    for (int m = 0; m < MOVES_PER_TICK; m++) {
+      rocketLevel(rocket);
+      rocketMove(rocket);
+    }
+  }
+  long sink = 0;
+  double start = nowSeconds();
+  for (long k = 0; k < BENCH_TICKS; k++) {
+    Reference r = references[k % numStates];
+    referenceTick(r, buttons[k % numStates]);
+    sink += r.speed + r.fuel;
+  }
+  double doubles = nowSeconds() - start;
+  start = nowSeconds();
+  for (long k = 0; k < BENCH_TICKS; k++) {
+    Rocket r = states[k % numStates];
+    rocketTick(r, buttons[k % numStates]);
+    sink += r.speed + r.fuel;
+  }
+  double fixedPoint = nowSeconds() - start;
+  printf("tick: %.1f ns on doubles, %.1f ns in fixed point on the host (%ld)\n",
+         doubles * 1e9 / BENCH_TICKS, fixedPoint * 1e9 / BENCH_TICKS, sink & 1);
+}
+
+int main(int argc, char **argv) {
+  int flights = argc > 1 ? atoi(argv[1]) : DEFAULT_FLIGHTS;
+  bool ok = checkFlights(flights);
+  ok = checkScripts() && ok;
+  benchTicks();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+// Rocket physics
+#include "rocket.h"
+
+#define ROCKET_NUM_LEVELS 4
+
+// Gravity in each layer of the atmosphere and the altitude where the next one starts
+static const fixed rocketGravity[ROCKET_NUM_LEVELS] = {fixedConst(1.0), fixedConst(3.0), fixedConst(2.0), fixedConst(1.0)};
+static const int rocketCeiling[ROCKET_NUM_LEVELS - 1] = {300, 9900, 33300};
+
+// None of the decimal steps is exact in Q16.16, so they are rounded to leave accel a little
+// over its decimal value and never under. Then truncating the boost, round() and comparing
+// with gravity all come out as they did on doubles, which sat on the decimal values.
+static const fixed rocketOne = fixedConst(1.0);
+static const fixed rocketMaxBoost = fixedConst(5.0);        // most an impulse makes of accel
+static const fixed rocketThrustEase = fixedConstBelow(0.1); // accel shed each tick of thrust
+static const fixed rocketFall = fixedConstAbove(0.02);      // accel gained each tick of falling
+static const fixed rocketCatchUp = fixedConstAbove(0.18);   // and more while it is below gravity
+
+void rocketBegin(Rocket &rocket, int ground, int maxFuel) {
+  rocket.y = rocket.ground = ground;
+  rocket.speed = 0;
+  rocket.height = 0;
+  rocket.fuel = rocket.maxFuel = maxFuel;
+  rocket.grav = rocket.accel = rocketGravity[0];
+  rocket.level = 0;
+  rocket.impulseHeld = false;
+  rocket.completed = false;
+  rocket.bonus = 0;
+}
+
+void rocketTick(Rocket &rocket, int buttons) {
+  bool thrust = buttons & ROCKET_THRUST;
+  bool impulse = buttons & ROCKET_IMPULSE;
+  if (rocket.y >= rocket.ground && rocket.fuel <= rocket.maxFuel) {
+    int refuel = rocket.maxFuel - rocket.fuel;
+    rocket.fuel += refuel < 10 ? refuel : 10;
+    rocket.accel = rocket.grav;
+  }
+  if (rocket.fuel > 0 && !rocket.impulseHeld && impulse) {
+    fixed fuel = fixedFromInt(rocket.fuel);
+    fixed tenth = fixedDivInt(fixedFromInt(rocket.maxFuel), 10);
+    if (fuel < tenth) rocket.fuel = 0;
+    else rocket.fuel = fixedToInt(fixedSub(fuel, tenth));
+    fixed boost = fixedDivInt(fixedMulInt(fixedMin(rocketMaxBoost, rocket.accel), rocket.maxFuel), 20);
+    rocket.speed = fixedToInt(fixedAdd(fixedFromInt(rocket.speed), boost));
+    if (rocket.accel > rocketOne) rocket.accel = fixedMax(fixedSub(rocket.accel, rocketOne), rocketOne);
+  }
+  if (rocket.fuel > 0 && thrust) {
+    rocket.fuel -= 1;
+    if (rocket.speed < 200) rocket.speed++;
+    if (rocket.accel > rocketOne) rocket.accel = fixedMax(fixedSub(rocket.accel, rocketThrustEase), rocketOne);
+  }
+  if (rocket.y != rocket.ground && !rocket.completed && (rocket.fuel <= 0 || !thrust)) {
+    rocket.accel = fixedAdd(rocket.accel, rocketFall);
+    if (rocket.accel < rocket.grav) rocket.accel = fixedAdd(rocket.accel, rocketCatchUp);
+    rocket.speed -= fixedRound(rocket.accel);
+  }
+  if (rocketAltitude(rocket) < rocketCeiling[0]) {
+    rocket.accel = rocket.grav;
+    if (rocket.speed < -16) rocket.speed += 9;
+    else if (rocket.speed < -7) rocket.speed += 2;
+    else if (rocket.speed == -7) rocket.speed++;
+  }
+  rocket.impulseHeld = impulse;
+}
+
+int rocketLevel(Rocket &rocket) {
+  int altitude = rocketAltitude(rocket);
+  int level = 0;
+  while (level < ROCKET_NUM_LEVELS - 1 && altitude >= rocketCeiling[level]) level++;
+  rocket.level = level;
+  rocket.grav = rocketGravity[level];
+  return level;
+}
+
+RocketLanding rocketMove(Rocket &rocket) {
+  if (rocket.speed > 0) rocket.height += rocket.speed;
+  rocket.y -= rocket.speed;
+  if (rocket.y <= rocket.ground) return ROCKET_FLYING;
+  RocketLanding landing = ROCKET_LANDED;
+  rocket.y = rocket.ground;
+  if (rocket.speed <= -7) {
+    int damage = ((6 + rocket.speed) * rocket.maxFuel)/40;
+    rocket.fuel += damage;
+    rocket.maxFuel += damage;
+    landing = ROCKET_CRASHED;
+  } else if (rocket.speed < 0 && rocket.height > 100) {
+    rocket.bonus = rocket.height/100;
+    landing = ROCKET_BONUS;
+    if (rocket.speed > -3) {
+      rocket.height *= 2;
+      landing = ROCKET_DOUBLE_BONUS;
+    }
+    rocket.maxFuel += rocket.height/100;
+    rocket.fuel = rocket.maxFuel;
+  }
+  rocket.height = 0;
+  rocket.speed = 0;
+  return landing;
+}
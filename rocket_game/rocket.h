@@ -0,0 +1,51 @@
+// Rocket physics
+// The sums behind the rocket game, on integers and Q16.16 fixed point (fixed.h) rather than
+// doubles, which the ESP32-S3 can only do in software. No clock, pins or screen: the sketch
+// calls rocketTick() every SIMULATION_STEP with the buttons held, rocketLevel() every
+// CLEAR_STEP and rocketMove() every DRAW_STEP, and draws what they report, so the same inputs
+// play out the same way on the board and on the host.
+#ifndef ROCKET_H
+#define ROCKET_H
+
+#include "fixed.h"
+
+// Buttons held during a tick
+#define ROCKET_THRUST 1   // LEFT, burns fuel steadily while held
+#define ROCKET_IMPULSE 2  // RIGHT, a tenth of the tank at once on each press
+
+// How the last rocketMove() ended
+enum RocketLanding {
+  ROCKET_FLYING,        // still in the air, or sat on the ground
+  ROCKET_LANDED,        // touched down with nothing to show for it
+  ROCKET_CRASHED,       // came down too fast and lost fuel and tank
+  ROCKET_BONUS,         // landed after a climb, the tank grows by bonus
+  ROCKET_DOUBLE_BONUS   // landed softly too, the tank grows by twice bonus
+};
+
+struct Rocket {
+  int y, ground;          // rows on the screen, counted down from the top
+  int speed;              // rows per DRAW_STEP, upwards
+  int height;             // climbed since the last landing
+  int fuel, maxFuel;
+  fixed grav, accel;
+  int level;              // layer of the atmosphere, 0 at the ground to 3 in space
+  bool impulseHeld;       // RIGHT was down last tick, an impulse wants a fresh press
+  bool completed;
+  int bonus;              // $ shown for the last bonus landing
+};
+
+void rocketBegin(Rocket &rocket, int ground, int maxFuel);
+
+// Height above the ground
+inline int rocketAltitude(const Rocket &rocket) {
+  return rocket.ground - rocket.y;
+}
+
+void rocketTick(Rocket &rocket, int buttons);
+
+// Sets gravity for the layer the rocket is in and returns the layer
+int rocketLevel(Rocket &rocket);
+
+RocketLanding rocketMove(Rocket &rocket);
+
+#endif
@@ -0,0 +1,437 @@
+// Snake rules host benchmark
+// Plays whole games of the rules in snake.h with no board attached: checks that a seed and
+// its inputs always give the same game, fuzzes the rules for broken invariants, including on
+// a board small enough to fill up, measures steps per second on boards up to 1024x1024 and
+// reports how the speed curve plays out.
+// Then times swarms of up to 400 enemies on the swarm preset's board, failing if a step takes
+// longer than MINPERIOD, the enemy pathfinding on boards up to 256x256, with and without a
+// budget, and whole games played by the autopilot, which is the rules engine's throughput
+// with a player that lasts.
+// Build from snake_game/host:
+//   g++ -O2 -march=native -I.. snake_bench.cpp ../snake.cpp ../snake_board.cpp ../snake_ai.cpp ../snake_bot.cpp -o snake_bench
+// Usage: snake_bench [games] [seed]
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <chrono>
+#include "snake.h"
+#include "snake_bot.h"
+
+#define DEFAULT_GAMES 2000
+#define MAX_STEPS 20000 // a game still going after this many steps is stopped
+#define THROUGHPUT_STEPS 2000000
+#define AI_STEPS 5000
+#define AI_ENEMIES 4
+#define AI_BUDGET 2000 // snakeFieldWork() units per step for the budgeted runs
+#define SWARM_STEPS 20000
+#define BOT_STEPS 50000
+#define BOT_BUDGET 4000 // cells the autopilot searches per decision for the budgeted runs
+
+static double nowSeconds() {
+  using namespace std::chrono;
+  return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Time this thread has spent running, which leaves out the time the scheduler gave to others
+static double threadSeconds() {
+  timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Direction each combination of buttons moves in, as in snake.cpp: down, left, right, up
+static const int buttonDirection[4] = {0, 3, 1, 2};
+
+// Buttons for the next step: whatever was held last time, changed now and then, like a
+// player who turns every few steps but never straight back into their own neck. Drawn from
+// its own generator so the game's is untouched.
+static int randomButtons(uint32_t &state, int held) {
+  state = state * 1664525 + 1013904223;
+  if ((state >> 24) >= 48) return held;
+  int buttons = (state >> 8) & (SNAKE_LEFT | SNAKE_RIGHT);
+  if (buttonDirection[buttons] == (buttonDirection[held] + 2) % SNAKE_NUM_DIRECTIONS) return held;
+  return buttons;
+}
+
+// FNV-1a over everything a step depends on
+static uint32_t gameHash(const SnakeGame &game) {
+  uint32_t hash = 2166136261u;
+  int cells = game.board.xdim * game.board.ydim;
+  for (int k = 0; k < cells; k++) {
+    hash = (hash ^ game.board.occupied[k]) * 16777619u;
+    hash = (hash ^ game.board.food[k]) * 16777619u;
+  }
+  for (int t = 0; t < game.player.length; t++) hash = (hash ^ snakeSegment(game.player, t)) * 16777619u;
+  const int values[] = {game.x, game.y, game.size, game.period, game.timer, game.round, game.invincible,
+                        (int)game.random, (int)game.steps};
+  for (int value : values) hash = (hash ^ (uint32_t)value) * 16777619u;
+  return hash;
+}
+
+// Returns a description of the first broken invariant, or NULL
+static const char *checkGame(const SnakeGame &game) {
+  const SnakeConfig &config = game.config;
+  int cells = config.xdim * config.ydim;
+  long covered = 0, expected = game.player.length;
+  for (int k = 0; k < cells; k++) covered += game.board.occupied[k];
+  for (int k = 0; k < game.enemies.count; k++) expected += game.enemies.bodies[k].length;
+  if (covered != expected) return "occupancy does not match the bodies";
+  if (game.player.length > game.size - 1) return "player longer than its size";
+  for (int t = 0; t < game.player.length; t++) {
+    if (game.board.occupied[snakeSegment(game.player, t)] == 0) return "player segment on a free cell";
+  }
+  const SnakeBoard &board = game.board;
+  int free = 0;
+  for (int k = 0; k < cells; k++) {
+    if (board.food[k] != SNAKE_NO_FOOD && board.occupied[k] > 0) return "food under a body";
+    if (!snakeCellFree(board, k)) continue;
+    free++;
+    if ((int)board.freeIndex[k] >= board.numFree || (int)board.freeCells[board.freeIndex[k]] != k) {
+      return "free cell missing from the free set";
+    }
+  }
+  if (free != board.numFree) return "free set holds cells that are not free";
+  if (game.period < config.minPeriod || game.period > config.maxPeriod) return "period out of range";
+  if (game.x < 0 || game.x >= config.xdim || game.y < 0 || game.y >= config.ydim) return "head off the board";
+  if (game.size < 4) return "player shorter than the minimum";
+  return NULL;
+}
+
+struct GameResult {
+  unsigned long steps;
+  int size;
+  int period;
+  uint32_t hash;
+  const char *broken;
+};
+
+static GameResult playGame(const SnakeConfig &config, uint32_t inputSeed, bool check) {
+  SnakeGame game;
+  GameResult result = {0, 0, 0, 0, NULL};
+  if (!snakeBegin(game, config)) {
+    result.broken = "out of memory";
+    return result;
+  }
+  int held = 0;
+  while (!game.over && game.steps < MAX_STEPS) {
+    held = randomButtons(inputSeed, held);
+    snakeStep(game, held);
+    if (check && !result.broken) result.broken = checkGame(game);
+  }
+  result.steps = game.steps;
+  result.size = game.size;
+  result.period = game.period;
+  result.hash = gameHash(game);
+  snakeEnd(game);
+  return result;
+}
+
+// Same seeds, same games, and recording for a renderer must not change the play
+static bool checkDeterminism(int games, uint32_t seed) {
+  SnakeConfig config;
+  snakeDefaultConfig(config);
+  for (int g = 0; g < games; g++) {
+    config.seed = seed + g;
+    config.record = false;
+    GameResult a = playGame(config, seed * 7 + g, false);
+    GameResult b = playGame(config, seed * 7 + g, false);
+    config.record = true;
+    GameResult c = playGame(config, seed * 7 + g, false);
+    if (a.hash != b.hash || a.hash != c.hash || a.steps != c.steps) {
+      printf("game %d differs: %08x %08x %08x\n", g, a.hash, b.hash, c.hash);
+      return false;
+    }
+  }
+  printf("determinism: %d games replayed identically, with and without recording\n", games);
+  return true;
+}
+
+// The sketch's settings with other enemies, on another board if given
+static SnakeConfig enemyConfig(int enemies, int ai = SNAKE_AI_WANDER, int xdim = 17, int ydim = 32) {
+  SnakeConfig config;
+  snakeDefaultConfig(config);
+  config.xdim = xdim;
+  config.ydim = ydim;
+  config.enemies = enemies;
+  config.ai = ai;
+  return config;
+}
+
+// Random games with every invariant checked after every step, and what the speed curve did
+// in them
+static bool fuzzRules(int games, uint32_t seed, SnakeConfig config) {
+  config.record = true;
+  unsigned long steps = 0, longest = 0;
+  double sizes = 0, periods = 0;
+  int fastest = config.maxPeriod;
+  for (int g = 0; g < games; g++) {
+    config.seed = seed + g;
+    GameResult result = playGame(config, seed * 13 + g, true);
+    if (result.broken) {
+      printf("seed %lu: %s\n", (unsigned long)config.seed, result.broken);
+      return false;
+    }
+    steps += result.steps;
+    if (result.steps > longest) longest = result.steps;
+    sizes += result.size;
+    periods += result.period;
+    if (result.period < fastest) fastest = result.period;
+  }
+  printf("fuzz, %dx%d, %d enem%s%s: %d games, %.1f steps and length %.1f on average, longest %lu steps, "
+         "final period %.1f ms on average, fastest %d ms\n",
+         config.xdim, config.ydim, config.enemies, config.enemies == 1 ? "y" : "ies",
+         config.ai == SNAKE_AI_WANDER ? "" : " with pathfinding", games, (double)steps / games, sizes / games, longest,
+         periods / games, fastest);
+  return true;
+}
+
+// Steps per second on one board size, starting a new game whenever one ends
+static void benchThroughput(int xdim, int ydim, bool record) {
+  SnakeConfig config;
+  snakeDefaultConfig(config);
+  config.xdim = xdim;
+  config.ydim = ydim;
+  config.record = record;
+  SnakeGame game;
+  uint32_t inputSeed = 1;
+  int held = 0;
+  unsigned long games = 0, changes = 0;
+  double setup = 0;
+  double start = nowSeconds();
+  double begun = start;
+  snakeBegin(game, config);
+  setup += nowSeconds() - begun;
+  for (long s = 0; s < THROUGHPUT_STEPS; s++) {
+    if (game.over) {
+      snakeEnd(game);
+      config.seed++;
+      begun = nowSeconds();
+      snakeBegin(game, config);
+      setup += nowSeconds() - begun;
+      games++;
+    }
+    held = randomButtons(inputSeed, held);
+    snakeStep(game, held);
+    changes += game.numChanges;
+  }
+  double elapsed = nowSeconds() - start;
+  snakeEnd(game);
+  printf("%4dx%-4d %-9s %6.2f Msteps/s, %6.1f ns/step excluding setup, %lu games, %.1f changes/step\n", xdim,
+         ydim, record ? "recorded" : "headless", THROUGHPUT_STEPS / elapsed / 1e6,
+         (elapsed - setup) * 1e9 / THROUGHPUT_STEPS, games, (double)changes / THROUGHPUT_STEPS);
+}
+
+// Shortest way round the board from one cell to another
+static int torusDistance(const SnakeBoard &board, int a, int b) {
+  int dx = abs(a / board.ydim - b / board.ydim), dy = abs(a % board.ydim - b % board.ydim);
+  if (dx > board.xdim / 2) dx = board.xdim - dx;
+  if (dy > board.ydim / 2) dy = board.ydim - dy;
+  return dx + dy;
+}
+
+// AI_STEPS steps with AI_ENEMIES enemies on one board, a new game whenever one ends. Reports the
+// mean time of a step, the mean and most field work in one (what the budget caps, wall-clock
+// worst cases on a desktop are mostly the scheduler), how many steps a field takes to rebuild,
+// how fast the enemies grow (each fruit is one) and how close they keep to the player.
+static void benchAi(int xdim, int ydim, int ai, long budget) {
+  SnakeConfig config;
+  snakeDefaultConfig(config);
+  config.xdim = xdim;
+  config.ydim = ydim;
+  config.enemies = AI_ENEMIES;
+  config.ai = ai;
+  config.aiBudget = budget;
+  SnakeGame game;
+  snakeBegin(game, config);
+  uint32_t inputSeed = 1;
+  int held = 0;
+  double total = 0, work = 0, distance = 0;
+  long most = 0;
+  unsigned long rebuilds = 0, grown = 0;
+  for (int s = 0; s < AI_STEPS; s++) {
+    if (game.over) {
+      rebuilds += game.foodField.rebuilds + game.playerField.rebuilds;
+      snakeEnd(game);
+      config.seed++;
+      snakeBegin(game, config);
+    }
+    held = randomButtons(inputSeed, held);
+    int sizes = 0;
+    for (int k = 0; k < game.enemies.count; k++) sizes += game.enemies.sizes[k];
+    double start = nowSeconds();
+    snakeStep(game, held);
+    total += nowSeconds() - start;
+    work += game.aiWork;
+    if (game.aiWork > most) most = game.aiWork;
+    for (int k = 0; k < game.enemies.count; k++) {
+      grown += game.enemies.sizes[k];
+      distance += torusDistance(game.board, game.enemies.heads[k], game.x*ydim + game.y);
+    }
+    grown -= sizes;
+  }
+  rebuilds += game.foodField.rebuilds + game.playerField.rebuilds;
+  int fields = (game.foodField.distance != NULL) + (game.playerField.distance != NULL);
+  snakeEnd(game);
+  const char *names[] = {"wander", "food", "player", "mixed"};
+  char limit[16];
+  if (budget == SNAKE_UNLIMITED) snprintf(limit, sizeof limit, "none");
+  else snprintf(limit, sizeof limit, "%ld", budget);
+  printf("%4dx%-4d %-6s budget %-5s %7.2f us/step, %7.0f units/step, most %6ld, %5.1f ns/unit, "
+         "%5.1f steps/rebuild, %5.1f fruit/1000 steps, %5.1f from the player\n",
+         xdim, ydim, names[ai], limit, total * 1e6 / AI_STEPS, work / AI_STEPS, most,
+         work > 0 ? total * 1e9 / work : 0.0, rebuilds ? (double)AI_STEPS * fields / rebuilds : 0.0,
+         grown * 1000.0 / AI_STEPS,
+         distance / ((double)AI_STEPS * AI_ENEMIES));
+}
+
+// SWARM_STEPS recorded steps of the swarm preset with this many enemies, a new game whenever
+// one ends. The sketch has to fit a step and its drawing in MINPERIOD, so the slowest step is
+// timed on this thread's clock, leaving out the scheduler's interruptions, and reported
+// against minPeriod along with the most units any step charged to aiBudget. Fails if the
+// slowest step takes longer than minPeriod: the board is slower than the host, so a step that
+// misses it here surely misses it there.
+static bool benchSwarm(int enemies, int ai) {
+  SnakeConfig config;
+  snakeSwarmConfig(config);
+  config.enemies = enemies;
+  config.ai = ai;
+  config.record = true;
+  SnakeGame game;
+  snakeBegin(game, config);
+  uint32_t inputSeed = 1;
+  int held = 0;
+  double total = 0, slowest = 0;
+  long most = 0;
+  unsigned long games = 1, changes = 0;
+  for (int s = 0; s < SWARM_STEPS; s++) {
+    if (game.over) {
+      snakeEnd(game);
+      config.seed++;
+      snakeBegin(game, config);
+      games++;
+    }
+    held = randomButtons(inputSeed, held);
+    double start = nowSeconds(), started = threadSeconds();
+    snakeStep(game, held);
+    double ran = threadSeconds() - started;
+    total += nowSeconds() - start;
+    if (ran > slowest) slowest = ran;
+    if (game.aiWork > most) most = game.aiWork;
+    changes += game.numChanges;
+  }
+  snakeEnd(game);
+  bool fits = slowest * 1000 <= config.minPeriod;
+  printf("%4d enemies %-6s %7.2f us/step, slowest %7.2f us (%5.2f%% of %d ms), most %5ld units, "
+         "%5.1f ns/enemy, %6.1f changes/step, %lu games%s\n",
+         enemies, ai == SNAKE_AI_WANDER ? "wander" : "mixed", total * 1e6 / SWARM_STEPS, slowest * 1e6,
+         slowest * 1e5 / config.minPeriod, config.minPeriod, most,
+         enemies ? total * 1e9 / SWARM_STEPS / enemies : 0.0, (double)changes / SWARM_STEPS, games,
+         fits ? "" : ", over MINPERIOD");
+  return fits;
+}
+
+// BOT_STEPS steps with the autopilot at the buttons, a new game whenever one ends. Reports
+// steps per second for the rules and the bot together, the mean decision time, the mean and
+// most cells searched for one (what the budget caps), how long the games lasted and how long
+// the player grew.
+static bool benchBot(const SnakeConfig &base, const char *name, long budget) {
+  SnakeConfig config = base;
+  SnakeGame game;
+  SnakeBot bot;
+  if (!snakeBegin(game, config) || !snakeBotBegin(bot, config.xdim * config.ydim, budget)) {
+    printf("out of memory\n");
+    return false;
+  }
+  double thinking = 0, lengths = 0;
+  long most = 0;
+  double work = 0;
+  unsigned long games = 0, longest = 0;
+  const char *broken = NULL;
+  double start = nowSeconds();
+  for (long s = 0; s < BOT_STEPS; s++) {
+    if (game.over) {
+      games++;
+      lengths += game.size;
+      if (game.steps > longest) longest = game.steps;
+      snakeEnd(game);
+      config.seed++;
+      snakeBegin(game, config);
+    }
+    double begun = nowSeconds();
+    int buttons = snakeBotButtons(bot, game);
+    thinking += nowSeconds() - begun;
+    work += bot.work;
+    if (bot.work > most) most = bot.work;
+    snakeStep(game, buttons);
+    if (!broken && s % 64 == 0) broken = checkGame(game);
+  }
+  double total = nowSeconds() - start;
+  if (game.steps > longest) longest = game.steps;
+  // The game still going counts as one, at the length it has reached
+  games++;
+  lengths += game.size;
+  snakeEnd(game);
+  char limit[16];
+  if (budget == SNAKE_UNLIMITED) snprintf(limit, sizeof limit, "none");
+  else snprintf(limit, sizeof limit, "%ld", budget);
+  printf("%-8s %3dx%-3d budget %-5s %6.3f Msteps/s, %6.2f us/decision, %6.0f cells mean %6ld most, "
+         "%5lu games, length %6.1f mean, longest %6lu steps, %4.1f%% moves unsafe\n",
+         name, config.xdim, config.ydim, limit, BOT_STEPS / total / 1e6, thinking * 1e6 / BOT_STEPS,
+         work / BOT_STEPS, most, games, lengths / games, longest, 100.0 * bot.unsafeMoves / BOT_STEPS);
+  snakeBotEnd(bot);
+  if (broken) printf("autopilot game broke: %s\n", broken);
+  return broken == NULL;
+}
+
+int main(int argc, char **argv) {
+  int games = argc > 1 ? atoi(argv[1]) : DEFAULT_GAMES;
+  uint32_t seed = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+
+  bool same = checkDeterminism(games / 10 + 1, seed);
+  SnakeConfig swarm;
+  snakeSwarmConfig(swarm);
+  swarm.ai = SNAKE_AI_MIXED;
+  bool sound = fuzzRules(games, seed, enemyConfig(0)) && fuzzRules(games, seed, enemyConfig(1)) &&
+               fuzzRules(games, seed, enemyConfig(AI_ENEMIES)) &&
+               fuzzRules(games, seed, enemyConfig(AI_ENEMIES, SNAKE_AI_MIXED)) &&
+               // Crowded enough that the board fills and fruit has to wait for a free cell
+               fuzzRules(games, seed, enemyConfig(AI_ENEMIES, SNAKE_AI_WANDER, 6, 6)) &&
+               fuzzRules(games / 10 + 1, seed, swarm);
+
+  printf("\nthroughput, a new game whenever one ends\n");
+  const int sizes[][2] = {{17, 32}, {64, 64}, {256, 256}, {1024, 1024}};
+  for (const auto &size : sizes) {
+    benchThroughput(size[0], size[1], false);
+    benchThroughput(size[0], size[1], true);
+  }
+
+  printf("\nswarms on the %dx%d board, %d steps each\n", swarm.xdim, swarm.ydim, SWARM_STEPS);
+  const int counts[] = {0, 25, 50, 100, 200, 400};
+  bool swarmsFit = true;
+  for (int enemies : counts) {
+    swarmsFit = benchSwarm(enemies, SNAKE_AI_WANDER) && swarmsFit;
+    swarmsFit = benchSwarm(enemies, SNAKE_AI_MIXED) && swarmsFit;
+  }
+
+  printf("\nenemy pathfinding, %d enemies over %d steps\n", AI_ENEMIES, AI_STEPS);
+  const int boards[][2] = {{17, 32}, {64, 64}, {128, 128}, {256, 256}};
+  for (const auto &board : boards) {
+    benchAi(board[0], board[1], SNAKE_AI_WANDER, 0);
+    for (int ai = SNAKE_AI_FOOD; ai <= SNAKE_AI_MIXED; ai++) {
+      benchAi(board[0], board[1], ai, SNAKE_UNLIMITED);
+      benchAi(board[0], board[1], ai, AI_BUDGET);
+    }
+  }
+
+  printf("\nautopilot, %d steps each\n", BOT_STEPS);
+  SnakeConfig alone = enemyConfig(0), big = enemyConfig(1, SNAKE_AI_WANDER, 64, 64);
+  SnakeConfig hunted = enemyConfig(AI_ENEMIES, SNAKE_AI_MIXED);
+  struct { const char *name; SnakeConfig config; } runs[] = {
+    {"alone", alone}, {"classic", enemyConfig(1)}, {"hunted", hunted}, {"swarm", swarm}, {"big", big}};
+  bool played = true;
+  for (const auto &run : runs) {
+    played = benchBot(run.config, run.name, SNAKE_UNLIMITED) && played;
+    played = benchBot(run.config, run.name, BOT_BUDGET) && played;
+  }
+  return same && sound && swarmsFit && played ? 0 : 1;
+}
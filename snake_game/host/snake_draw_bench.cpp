@@ -0,0 +1,178 @@
+// Snake cell drawing host benchmark
+// Draws the same cells with fillRoundRect() and from the tile atlas into two stub panels:
+// checks the tiles give exactly the pixels fillRoundRect() does, then reports what a cell
+// costs each way in address windows and bus bytes, which is what the panel waits on, and
+// replays recorded games to show the cost per step. Host times are for the stub only, the
+// board's own figures come from DRAW_BENCH in main.cpp.
+// Build from snake_game/host:
+//   g++ -O2 -pthread -I../../water_ripples/host/stub -I.. snake_draw_bench.cpp ../snake_render.cpp ../snake.cpp
+//       ../snake_board.cpp ../snake_ai.cpp ../../water_ripples/host/stub/stub.cpp -o snake_draw_bench
+// Usage: snake_draw_bench [games]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <TFT_eSPI.h>
+#include "snake.h"
+#include "snake_render.h"
+
+#define XDIM 17
+#define YDIM 32
+#define L 10
+#define NUM_SHADES SNAKE_FADE_STEPS
+#define WHITE_TILE NUM_SHADES
+#define NUM_TILES (WHITE_TILE + SNAKE_FOOD_KINDS)
+#define RANDOM_CELLS 200000
+#define DEFAULT_GAMES 200
+// Bytes to open a window on the panel: column and row address commands with four bytes of
+// data each, then the memory write command
+#define WINDOW_BYTES 11
+
+static double nowSeconds() {
+  using namespace std::chrono;
+  return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+// The sketch's colours: its fading shades, white, then the food
+static void tileColours(uint16_t *colours) {
+  colours[0] = TFT_BLACK;
+  for (int i = 1; i < NUM_SHADES; i++) colours[i] = i < 2 ? ((2 << 11) | (2*2 << 5) | 2) : ((i << 11) | (2*i << 5) | i);
+  colours[WHITE_TILE] = TFT_WHITE;
+  const uint16_t food[SNAKE_FOOD_KINDS] = {TFT_BLACK, TFT_RED, TFT_GREENYELLOW, TFT_CYAN, TFT_GOLD};
+  for (int f = SNAKE_FOOD_RED; f < SNAKE_FOOD_KINDS; f++) colours[WHITE_TILE + f] = food[f];
+}
+
+struct DrawCost {
+  unsigned long cells, windows, pixels;
+  double seconds;
+};
+
+static void reportCost(const char *name, const DrawCost &cost, unsigned long per, const char *unit) {
+  double n = per ? (double)per : 1.0;
+  printf("  %-13s %6.1f cells, %6.1f windows, %7.1f pixels, %8.1f bus bytes per %s, %6.1f ns per cell on the host\n",
+         name, cost.cells / n, cost.windows / n, cost.pixels / n,
+         (cost.windows * WINDOW_BYTES + cost.pixels * 2.0) / n, unit,
+         cost.cells ? cost.seconds * 1e9 / cost.cells : 0.0);
+}
+
+static bool samePanels(TFT_eSPI &a, TFT_eSPI &b) {
+  return memcmp(a.framebuffer(), b.framebuffer(), a.width() * a.height() * sizeof(uint16_t)) == 0;
+}
+
+// Every cell of the board redrawn in random tiles, one path at a time
+static bool benchRandom(const SnakeAtlas &atlas) {
+  TFT_eSPI rounded, tiled;
+  SnakeScreen roundedScreen, tiledScreen;
+  rounded.init();
+  tiled.init();
+  snakeScreenBegin(roundedScreen, XDIM, YDIM, L);
+  snakeScreenBegin(tiledScreen, XDIM, YDIM, L);
+  DrawCost cost[2] = {};
+  uint32_t state = 1;
+  for (int method = 0; method < 2; method++) {
+    TFT_eSPI &tft = method == 0 ? rounded : tiled;
+    SnakeScreen &screen = method == 0 ? roundedScreen : tiledScreen;
+    state = 1;
+    double start = nowSeconds();
+    for (int k = 0; k < RANDOM_CELLS; k++) {
+      state = state * 1664525 + 1013904223;
+      int cell = (state >> 8) % (XDIM * YDIM);
+      int tile = (state >> 24) % NUM_TILES;
+      bool drawn = method == 0 ? snakeDrawCell(tft, screen, cell / YDIM, cell % YDIM, atlas.colours[tile])
+                               : snakeDrawTile(tft, screen, atlas, cell / YDIM, cell % YDIM, tile);
+      cost[method].cells += drawn;
+    }
+    cost[method].seconds = nowSeconds() - start;
+    cost[method].windows = tft.windowsOpened();
+    cost[method].pixels = tft.pixelsWritten();
+  }
+  bool same = samePanels(rounded, tiled);
+  printf("random cells, %d redraws in %d tiles: %s\n", RANDOM_CELLS, NUM_TILES,
+         same ? "tiles match fillRoundRect pixel for pixel" : "TILES DIFFER FROM fillRoundRect");
+  reportCost("fillRoundRect", cost[0], cost[0].cells, "cell");
+  reportCost("atlas", cost[1], cost[1].cells, "cell");
+  snakeScreenEnd(roundedScreen);
+  snakeScreenEnd(tiledScreen);
+  return same;
+}
+
+// Whole games as the sketch draws them, one enemy and random turns
+static bool benchGames(const SnakeAtlas &atlas, int games) {
+  TFT_eSPI rounded, tiled;
+  SnakeScreen roundedScreen, tiledScreen;
+  rounded.init();
+  tiled.init();
+  snakeScreenBegin(roundedScreen, XDIM, YDIM, L);
+  snakeScreenBegin(tiledScreen, XDIM, YDIM, L);
+  DrawCost cost[2] = {};
+  unsigned long steps = 0;
+  bool same = true;
+  uint32_t input = 7;
+  for (int g = 0; g < games && same; g++) {
+    SnakeConfig config;
+    snakeDefaultConfig(config);
+    config.seed = g + 1;
+    config.record = true;
+    SnakeGame game;
+    if (!snakeBegin(game, config)) return false;
+    rounded.fillScreen(TFT_BLACK);
+    tiled.fillScreen(TFT_BLACK);
+    snakeScreenInvalidate(roundedScreen);
+    snakeScreenInvalidate(tiledScreen);
+    int buttons = 0;
+    while (!game.over) {
+      for (int method = 0; method < 2; method++) {
+        TFT_eSPI &tft = method == 0 ? rounded : tiled;
+        SnakeScreen &screen = method == 0 ? roundedScreen : tiledScreen;
+        unsigned long windows = tft.windowsOpened(), pixels = tft.pixelsWritten();
+        double start = nowSeconds();
+        for (int k = 0; k < game.numChanges; k++) {
+          const SnakeChange &change = game.changes[k];
+          int tile = change.food != SNAKE_NO_FOOD ? WHITE_TILE + change.food
+                   : change.stepsLeft >= NUM_SHADES - 1 ? WHITE_TILE : std::max(0, (int)change.stepsLeft);
+          int x = change.cell / YDIM, y = change.cell % YDIM;
+          bool drawn = method == 0 ? snakeDrawCell(tft, screen, x, y, atlas.colours[tile])
+                                   : snakeDrawTile(tft, screen, atlas, x, y, tile);
+          cost[method].cells += drawn;
+        }
+        cost[method].seconds += nowSeconds() - start;
+        cost[method].windows += tft.windowsOpened() - windows;
+        cost[method].pixels += tft.pixelsWritten() - pixels;
+      }
+      // Turn now and then, never straight back: opposite directions differ in both buttons
+      input = input * 1664525 + 1013904223;
+      if ((input >> 24) < 40) {
+        int next = (input >> 8) & (SNAKE_LEFT | SNAKE_RIGHT);
+        if ((next ^ buttons) != (SNAKE_LEFT | SNAKE_RIGHT)) buttons = next;
+      }
+      snakeStep(game, buttons);
+      steps++;
+    }
+    same = samePanels(rounded, tiled);
+    snakeEnd(game);
+  }
+  printf("\n%d games as the sketch draws them, %lu steps: %s\n", games, steps,
+         same ? "both panels identical after every game" : "PANELS DIFFER");
+  reportCost("fillRoundRect", cost[0], steps, "step");
+  reportCost("atlas", cost[1], steps, "step");
+  snakeScreenEnd(roundedScreen);
+  snakeScreenEnd(tiledScreen);
+  return same;
+}
+
+int main(int argc, char **argv) {
+  int games = argc > 1 ? atoi(argv[1]) : DEFAULT_GAMES;
+  uint16_t colours[NUM_TILES];
+  tileColours(colours);
+  SnakeAtlas atlas;
+  if (!snakeAtlasBegin(atlas, L, colours, NUM_TILES)) {
+    printf("out of memory\n");
+    return 1;
+  }
+  printf("atlas: %d tiles of %dx%d, %d bytes\n\n", atlas.numTiles, L, L, (int)(atlas.numTiles * L * L * sizeof(uint16_t)));
+  bool ok = benchRandom(atlas);
+  ok = benchGames(atlas, games) && ok;
+  snakeAtlasEnd(atlas);
+  return ok ? 0 : 1;
+}
@@ -2,11 +2,20 @@
 // Last update: 26/08/2025
 #include <Arduino.h>
 #include <TFT_eSPI.h>
+#include "snake.h"
+#include "snake_render.h"
+#include "snake_bot.h"
 
 #define LEFT 0
 #define RIGHT 14
 
-// simulation parameters
+// game modes
+#define CLASSIC 0  // one enemy, as the game has always been
+#define NO_ENEMY 1 // the player alone
+#define SWARM 2    // 120 short enemies on cells half the size, see snakeSwarmConfig()
+#define MODE CLASSIC
+
+// simulation parameters, see SnakeConfig
 #define STEPSIZE 100
 #define DEFTIMER 12
 #define PERIOD_DEC 1
@@ -14,32 +23,51 @@
 #define MAXPERIOD 500
 #define MINPERIOD 20
 #define INVINCIBILITY 50
-#define XDIM 17
-#define YDIM 32
+#define ENEMIES -1 // how many to play against, -1 for the mode's own
+#define ENEMY_AI SNAKE_AI_WANDER // or SNAKE_AI_FOOD, SNAKE_AI_PLAYER, SNAKE_AI_MIXED
+#define AI_BUDGET_MICROS 2000 // enemy time per step, moves and pathfinding, well inside MINPERIOD
+#define AUTOPLAY false // the autopilot plays, for soak runs; holding both buttons at power-on does too
+#define BOT_BUDGET_MICROS 4000 // autopilot search time per step, leaving MINPERIOD room for the rest
+#if MODE == SWARM
+#define L 5
+#else
 #define L 10
-#define NUM_DIRECTIONS 4
-#define NUM_COLOURS 10
-#define NUM_SHADES 32
+#endif
+#define NUM_SHADES SNAKE_FADE_STEPS
+#define SHADE_STEP 1 // steps a fading cell keeps each shade, raise to redraw the tail less often
+#define WHITE_TILE NUM_SHADES // atlas tiles: each shade, then white, then each kind of food
+#define DRAW_BENCH false // time fillRoundRect() against the atlas at startup, over Serial
+#define DRAW_BENCH_PASSES 10
 
 TFT_eSPI tft = TFT_eSPI(); // 170 x 320 pixels
 
-const int xDir[NUM_DIRECTIONS] = {0,1,0,-1}; //{1,1,0,-1,-1,-1,0,1};
-const int yDir[NUM_DIRECTIONS] = {1,0,-1,0}; //{0,1,1,1,0,-1,-1,-1};
-int grid[17][32];
-
+// Colour each kind of food is drawn in
+const uint16_t foodColours[SNAKE_FOOD_KINDS] = {TFT_BLACK, TFT_RED, TFT_GREENYELLOW, TFT_CYAN, TFT_GOLD};
 unsigned long shades[NUM_SHADES];
-int size = 8;
-int enemySize = 12;
-int s = 0;
-int e = 0;
-int c = -1;
+SnakeScreen screen;
+SnakeAtlas atlas;
+SnakeGame game;
+SnakeBot bot;
+bool autoplay = AUTOPLAY;
+unsigned long lastStep = 0;
+// Autopilot decision times, reported when a game ends: this game's total and the slowest yet
+unsigned long games = 0, thinking = 0, slowestDecision = 0;
 
 void gameOver();
+void restart();
+long searchBudget(int xdim, int ydim, long budgetMicros);
+void drawStatus();
+void drawChanges();
+int cellTile(const SnakeChange &change);
+int bodyTile(int stepsLeft);
+void drawBench();
+int fadeShade(int countdown);
 
 void setup()
 {
   pinMode(LEFT, INPUT_PULLUP);
   pinMode(RIGHT, INPUT_PULLUP);
+  if (!digitalRead(LEFT) && !digitalRead(RIGHT)) autoplay = true;
 
   shades[0] = 0x0000;
   for (int i = 1; i < NUM_SHADES-1; i++) {
@@ -56,154 +84,202 @@ void setup()
   tft.setTextSize(1);
   tft.setTextColor(TFT_WHITE, TFT_BLACK);
   Serial.begin(115200);
-}
-
-void loop()
-{
-  static int xPos = 9; // 9
-  static int yPos = 0; // 31
-  static int xEnemy = 2;
-  static int yEnemy = 17;
-  static unsigned long lastStep = 0;
-  static unsigned long clock = 0;
-  static int round = 0;
-  static int fruits = 1;
-  static int slowdown = 0;
-  static int speedup = 0;
-  static int invincible = 0;
-  static int treasure = 75;
-  static int period = STEPSIZE;
-  static int timer = DEFTIMER;
-
-  if (!digitalRead(LEFT) && !digitalRead(RIGHT)) {
-    s = 2;
-  } else if (!digitalRead(LEFT)) {
-    s = 3;
-  } else if (!digitalRead(RIGHT)) {
-    s = 1;
-  } else s = 0;
-
-  if (fruits > 0) {
-    int xFruit = random(0,XDIM);
-    int yFruit = random(0,YDIM);
-    int fruitType = random(0,100);
-    fruits--;
-    if (fruitType > 25 && fruitType <= 89) {
-      grid[xFruit][yFruit] = TFT_RED;
-      tft.fillRoundRect(xFruit*L, yFruit*L, L, L, 3, TFT_RED);
-    } else if (fruitType > 90 && invincible == 0) {
-      grid[xFruit][yFruit] = TFT_CYAN;
-      tft.fillRoundRect(xFruit*L, yFruit*L, L, L, 3, TFT_CYAN);
-    } else {
-      if (fruitType > treasure) {
-        if (treasure < 94) treasure += 5;
-        grid[xFruit][yFruit] = TFT_GOLD;
-        tft.fillRoundRect(xFruit*L, yFruit*L, L, L, 3, TFT_GOLD);
-      } else {
-        grid[xFruit][yFruit] = TFT_GREENYELLOW;
-        tft.fillRoundRect(xFruit*L, yFruit*L, L, L, 3, TFT_GREENYELLOW);
-      }
-    }
-    if (slowdown > 0) {
-      round = -slowdown * timer;
-      period = min(MAXPERIOD, period+slowdown*PERIOD_INC);
-      slowdown = 0;
-    } else if (speedup > 0) {
-      period = min(MAXPERIOD, period+speedup*PERIOD_INC);
-      speedup = 0;
-    } else {
-      period = min(MAXPERIOD, period+PERIOD_INC);
-    }
-  }
 
-  if (round >= timer) {
-    timer = DEFTIMER * (100/period) + (size / 8);
-    period = max(MINPERIOD, period-PERIOD_DEC);
-    round = 0;
+  SnakeConfig config;
+  if (MODE == SWARM) snakeSwarmConfig(config);
+  else snakeDefaultConfig(config);
+  if (MODE == NO_ENEMY) config.enemies = 0;
+  if (ENEMIES >= 0) config.enemies = ENEMIES;
+  config.ai = ENEMY_AI;
+  if (ENEMY_AI != SNAKE_AI_WANDER && config.enemies > 0) {
+    config.aiBudget = searchBudget(config.xdim, config.ydim, AI_BUDGET_MICROS);
   }
+  config.seed = random(1, 0x7fffffff);
+  config.record = true;
+  config.stepSize = STEPSIZE;
+  config.defaultTimer = DEFTIMER;
+  config.periodDec = PERIOD_DEC;
+  config.periodInc = PERIOD_INC;
+  config.maxPeriod = MAXPERIOD;
+  config.minPeriod = MINPERIOD;
+  config.invincibility = INVINCIBILITY;
 
-  if (millis() - clock > STEPSIZE) {
-    round++;
-    clock += STEPSIZE;
+  if (autoplay) {
+    long budget = searchBudget(config.xdim, config.ydim, BOT_BUDGET_MICROS);
+    if (!snakeBotBegin(bot, config.xdim * config.ydim, budget)) {
+      Serial.println("no memory for the autopilot");
+      autoplay = false;
+    }
   }
+  if (!snakeScreenBegin(screen, config.xdim, config.ydim, L)) Serial.println("no memory for the screen shadow");
+  uint16_t tileColours[WHITE_TILE + SNAKE_FOOD_KINDS];
+  for (int i = 0; i < NUM_SHADES; i++) tileColours[i] = shades[i];
+  tileColours[WHITE_TILE] = TFT_WHITE;
+  for (int f = SNAKE_FOOD_RED; f < SNAKE_FOOD_KINDS; f++) tileColours[WHITE_TILE + f] = foodColours[f];
+  if (!snakeAtlasBegin(atlas, L, tileColours, WHITE_TILE + SNAKE_FOOD_KINDS)) Serial.println("no memory for the tiles");
+  if (DRAW_BENCH) drawBench();
+  if (!snakeBegin(game, config)) Serial.println("no memory for the board");
+  drawChanges();
+}
 
-  if (millis() - lastStep > period) {
-    tft.setTextDatum(TR_DATUM);
-    if (round < 0) tft.setTextColor(TFT_GREENYELLOW, TFT_BLACK);
-    else tft.setTextColor(TFT_DARKGREY, TFT_BLACK);
-    tft.drawString(" " + String(1000.0/period) + " ",L*XDIM,0);
-    tft.setTextDatum(TL_DATUM);
-    if (invincible > 0) {
-      if (invincible != INVINCIBILITY) invincible--;
-      if (invincible >= 0.2 * INVINCIBILITY) tft.setTextColor(TFT_CYAN, TFT_BLACK);
-      if (invincible < 0.2*INVINCIBILITY) tft.setTextColor(TFT_DARKCYAN, TFT_BLACK);
-    }
-    else tft.setTextColor(TFT_WHITE, TFT_BLACK);
-    Serial.println(period);
-    Serial.println(timer);
-    tft.drawString(" " + String(size) + " ",0,0);
-    int food = grid[xPos][yPos];
-    int eFood = grid[xEnemy][yEnemy];
-    if (eFood == TFT_RED || eFood == TFT_GREENYELLOW || eFood == TFT_CYAN || eFood == TFT_GOLD) {
-      enemySize += 1;
-      fruits++;
-    }
-    if (food == TFT_RED || food == TFT_GREENYELLOW || food == TFT_CYAN || food == TFT_GOLD) {
-      size += 1;
-      if (food == TFT_GREENYELLOW) {
-        slowdown = 10;
-      } else if (food == TFT_CYAN) {
-        invincible = INVINCIBILITY;
-        speedup = 5;
-      } else if (food == TFT_GOLD) {
-        if (period <= 50) size += 55-period;
-        else size += 4;
-        if (treasure < 95) fruits++;
-      }
-      fruits++;
-    } else if (grid[xPos][yPos] > 0) {
-      if (invincible == 0) {
-        tft.fillScreen(TFT_BLACK);
-        gameOver();
-      }
-      invincible--;
-      grid[xPos][yPos] = 0;
+void loop()
+{
+  int buttons = 0;
+  if (!digitalRead(LEFT)) buttons |= SNAKE_LEFT;
+  if (!digitalRead(RIGHT)) buttons |= SNAKE_RIGHT;
 
-      size = max(4, size-1);
+  if (millis() - lastStep > game.period) {
+    lastStep += game.period;
+    unsigned long start = micros();
+    if (autoplay) {
+      buttons = snakeBotButtons(bot, game);
+      unsigned long decision = micros() - start;
+      thinking += decision;
+      slowestDecision = max(slowestDecision, decision);
     }
-    grid[xEnemy][yEnemy] = enemySize;
-    grid[xPos][yPos] = size;
-    for (int i = 0; i < XDIM; i++) {
-      for (int j = 0; j < YDIM; j++) {
-        int food = grid[i][j];
-        if (food <= 0) {
-          continue;
-        } else if (food == TFT_RED || food == TFT_GREENYELLOW || food == TFT_CYAN || food == TFT_GOLD) {
-          continue;
-        } else if (grid[i][j]-- >= NUM_SHADES) {
-          tft.fillRoundRect(i*L, j*L, L, L, 3, TFT_WHITE);
-        } else
-          tft.fillRoundRect(i*L, j*L, L, L, 3, shades[grid[i][j]]);
-      }
+    snakeStep(game, buttons);
+    if (game.over) {
+      tft.fillScreen(TFT_BLACK);
+      gameOver();
+      drawStatus();
+      return;
     }
-    xPos = (xPos + xDir[s]) % XDIM;
-    if (xPos < 0) xPos += XDIM;
-    yPos = (yPos + yDir[s]) % YDIM;
-    if (yPos < 0) yPos += YDIM;
-    e = (e + random(-1, 2))%NUM_DIRECTIONS;
-    if (e < 0) e += NUM_DIRECTIONS;
-    xEnemy = (xEnemy + xDir[e]) % XDIM;
-    if (xEnemy < 0) xEnemy += XDIM;
-    yEnemy = (yEnemy + yDir[e]) % YDIM;
-    if (yEnemy < 0) yEnemy += YDIM;
-    lastStep += period;
+    drawStatus();
+    drawChanges();
+    // Step and drawing together, which have to fit in MINPERIOD, taken before anything goes
+    // out over Serial so the writes are not counted
+    unsigned long elapsed = micros() - start;
+    Serial.println(game.period);
+    Serial.println(game.timer);
+    Serial.println(elapsed);
   }
 }
 
 void gameOver() {
   tft.setTextSize(2);
   tft.setTextDatum(CC_DATUM);
-  tft.drawString("Score: " + String(size), L*XDIM/2, L*YDIM/2);
+  tft.drawString("Score: " + String(game.size), L*screen.xdim/2, L*screen.ydim/2);
+  if (autoplay) {
+    games++;
+    Serial.print("game ");
+    Serial.print(games);
+    Serial.print(" over after ");
+    Serial.print(game.steps);
+    Serial.print(" steps, score ");
+    Serial.print(game.size);
+    Serial.print(", autopilot ");
+    Serial.print(thinking / max(game.steps, 1UL));
+    Serial.print(" us mean, slowest ");
+    Serial.print(slowestDecision);
+    Serial.println(" us");
+    thinking = 0;
+    delay(2000);
+    restart();
+    return;
+  }
   delay(10000);
   gameOver();
 }
+
+// A new game on the same settings, so the autopilot can play on for hours
+void restart() {
+  SnakeConfig config = game.config;
+  config.seed = random(1, 0x7fffffff);
+  snakeEnd(game);
+  tft.fillScreen(TFT_BLACK);
+  tft.setTextSize(1);
+  snakeScreenInvalidate(screen);
+  if (!snakeBegin(game, config)) Serial.println("no memory for the board");
+  drawChanges();
+  lastStep = millis();
+}
+
+// Pathfinding and the autopilot budget their searches in cells, so see how many fit in
+// budgetMicros by timing a few whole rebuilds of a field on an empty board
+long searchBudget(int xdim, int ydim, long budgetMicros) {
+  SnakeBoard board;
+  SnakeField field;
+  long work = 0;
+  unsigned long elapsed = 1;
+  if (snakeBoardBegin(board, xdim, ydim) && snakeFieldBegin(field, SNAKE_TARGET_PLAYER, xdim*ydim)) {
+    unsigned long start = micros();
+    for (int k = 0; k < 8; k++) work += snakeFieldWork(field, board, k, SNAKE_UNLIMITED);
+    elapsed = max(1UL, micros() - start);
+    snakeFieldEnd(field);
+  }
+  snakeBoardEnd(board);
+  long budget = max(1L, (long)((float)work * budgetMicros / elapsed));
+  Serial.print(budget);
+  Serial.println(" cells of search per step");
+  return budget;
+}
+
+// Speed in the top right, greenyellow while slowed down, and length in the top left, cyan
+// while invincible
+void drawStatus() {
+  tft.setTextDatum(TR_DATUM);
+  if (game.round < 0) tft.setTextColor(TFT_GREENYELLOW, TFT_BLACK);
+  else tft.setTextColor(TFT_DARKGREY, TFT_BLACK);
+  tft.drawString(" " + String(1000.0/game.period) + " ",L*screen.xdim,0);
+  tft.setTextDatum(TL_DATUM);
+  if (game.invincible >= 0.2 * INVINCIBILITY) tft.setTextColor(TFT_CYAN, TFT_BLACK);
+  else if (game.invincible > 0) tft.setTextColor(TFT_DARKCYAN, TFT_BLACK);
+  else tft.setTextColor(TFT_WHITE, TFT_BLACK);
+  tft.drawString(" " + String(game.size) + " ",0,0);
+}
+
+// Only cells whose shade changed are drawn, all in one transaction
+void drawChanges() {
+  snakeBatchStart(tft);
+  for (int k = 0; k < game.numChanges; k++) {
+    const SnakeChange &change = game.changes[k];
+    snakeDrawTile(tft, screen, atlas, change.cell / screen.ydim, change.cell % screen.ydim, cellTile(change));
+  }
+  snakeBatchFinish(tft);
+}
+
+int cellTile(const SnakeChange &change) {
+  if (change.food != SNAKE_NO_FOOD) return WHITE_TILE + change.food;
+  return bodyTile(change.stepsLeft);
+}
+
+// White until the last NUM_SHADES steps, then fading to black
+int bodyTile(int stepsLeft) {
+  if (stepsLeft >= NUM_SHADES - 1) return WHITE_TILE;
+  return fadeShade(stepsLeft);
+}
+
+// Shade of a body cell with countdown steps left, 0 (black) once it has gone
+int fadeShade(int countdown) {
+  if (countdown <= 0) return 0;
+  return max(1, countdown / SHADE_STEP * SHADE_STEP);
+}
+
+// Draws the whole board DRAW_BENCH_PASSES times with fillRoundRect() and again from the atlas,
+// switching colour every pass so no cell is skipped, and reports what a cell costs each way
+void drawBench() {
+  unsigned long elapsed[2];
+  for (int method = 0; method < 2; method++) {
+    unsigned long start = micros();
+    snakeBatchStart(tft);
+    for (int pass = 0; pass < DRAW_BENCH_PASSES; pass++) {
+      int tile = pass % 2 ? WHITE_TILE : WHITE_TILE + SNAKE_FOOD_RED;
+      for (int x = 0; x < screen.xdim; x++) {
+        for (int y = 0; y < screen.ydim; y++) {
+          if (method == 0) snakeDrawCell(tft, screen, x, y, atlas.colours[tile]);
+          else snakeDrawTile(tft, screen, atlas, x, y, tile);
+        }
+      }
+    }
+    snakeBatchFinish(tft);
+    elapsed[method] = micros() - start;
+  }
+  float cells = (float)DRAW_BENCH_PASSES * screen.xdim * screen.ydim;
+  Serial.print("fillRoundRect ");
+  Serial.print(elapsed[0] / cells);
+  Serial.print(" us/cell, atlas ");
+  Serial.print(elapsed[1] / cells);
+  Serial.println(" us/cell");
+  tft.fillScreen(TFT_BLACK);
+  snakeScreenInvalidate(screen);
+}
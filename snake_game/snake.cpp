@@ -0,0 +1,352 @@
+// Snake rules
+#include "snake.h"
+#include <stdlib.h>
+#include <algorithm>
+
+#define SNAKE_MIN_SIZE 4 // a crash while invincible shrinks the player, but not below this
+// Units of aiBudget charged for each enemy's move and the choice of its next direction, about
+// the neighbour lookups and writes of two cells searched from
+#define SNAKE_ENEMY_WORK 2
+
+static const int snakeXDir[SNAKE_NUM_DIRECTIONS] = {0,1,0,-1};
+static const int snakeYDir[SNAKE_NUM_DIRECTIONS] = {1,0,-1,0};
+// Direction for each combination of buttons: none, LEFT, RIGHT, both
+static const int snakeButtonDir[4] = {0, 3, 1, 2};
+
+void snakeDefaultConfig(SnakeConfig &config) {
+  config.xdim = 17;
+  config.ydim = 32;
+  config.enemies = 1;
+  config.enemyLength = 0;
+  config.ai = SNAKE_AI_WANDER;
+  config.aiBudget = 2000;
+  config.seed = 1;
+  config.record = false;
+  config.stepSize = 100;
+  config.defaultTimer = 12;
+  config.periodDec = 1;
+  config.periodInc = 1;
+  config.maxPeriod = 500;
+  config.minPeriod = 20;
+  config.invincibility = 50;
+  config.size = 8;
+  config.enemySize = 12;
+}
+
+void snakeSwarmConfig(SnakeConfig &config) {
+  snakeDefaultConfig(config);
+  config.xdim = 34;
+  config.ydim = 64;
+  config.enemies = 120;
+  config.enemySize = 4;
+  config.enemyLength = 16;
+}
+
+int snakeRandom(SnakeGame &game, int lo, int hi) {
+  // xorshift32
+  uint32_t x = game.random;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  game.random = x;
+  if (hi <= lo) return lo;
+  return lo + (int)(x % (uint32_t)(hi - lo));
+}
+
+static void snakeRecord(SnakeGame &game, int cell, int stepsLeft, int food) {
+  if (!game.changes || game.numChanges == game.maxChanges) return;
+  SnakeChange &change = game.changes[game.numChanges++];
+  change.cell = cell;
+  change.stepsLeft = std::min(stepsLeft, 0xffff);
+  change.food = food;
+}
+
+// Drops every fruit owed on a free cell, each one as likely as any other, and adjusts the
+// period: each spawn slows the game a little, more after a greenyellow or cyan fruit. Fruit
+// still owed when the board is full waits until a cell frees up.
+static void snakeSpawnFruit(SnakeGame &game) {
+  const SnakeConfig &config = game.config;
+  while (game.fruits > 0 && game.board.numFree > 0) {
+    int cell = game.board.freeCells[snakeRandom(game, 0, game.board.numFree)];
+    int fruitType = snakeRandom(game, 0, 100);
+    int food;
+    game.fruits--;
+    if (fruitType > 25 && fruitType <= 89) {
+      food = SNAKE_FOOD_RED;
+    } else if (fruitType > 90 && game.invincible == 0) {
+      food = SNAKE_FOOD_CYAN;
+    } else if (fruitType > game.treasure) {
+      if (game.treasure < 94) game.treasure += 5;
+      food = SNAKE_FOOD_GOLD;
+    } else {
+      food = SNAKE_FOOD_GREENYELLOW;
+    }
+    snakeBoardSetFood(game.board, cell, food);
+    snakeRecord(game, cell, 0, food);
+    game.aiWork += snakeFieldOpen(game.foodField, game.board, cell, true);
+    if (game.slowdown > 0) {
+      game.round = -game.slowdown * game.timer;
+      game.period = std::min(config.maxPeriod, game.period + game.slowdown*config.periodInc);
+      game.slowdown = 0;
+    } else if (game.speedup > 0) {
+      game.period = std::min(config.maxPeriod, game.period + game.speedup*config.periodInc);
+      game.speedup = 0;
+    } else {
+      game.period = std::min(config.maxPeriod, game.period + config.periodInc);
+    }
+  }
+}
+
+// Once enough rounds have passed the period drops. Rounds are counted in time rather than
+// steps, and the next wait is scaled by the steps that now fit in a round.
+static void snakeSpeedUp(SnakeGame &game) {
+  const SnakeConfig &config = game.config;
+  if (game.round < game.timer) return;
+  game.timer = config.defaultTimer * (config.stepSize / game.period) + game.size/8;
+  game.period = std::max(config.minPeriod, game.period - config.periodDec);
+  game.round = 0;
+}
+
+// A segment has left cell: if that was the last one the fields can route through it again,
+// and unless there is food under it the renderer clears it
+static void snakeEraseCell(SnakeGame &game, int cell) {
+  if (game.board.occupied[cell] > 0) return;
+  bool food = game.board.food[cell] != SNAKE_NO_FOOD;
+  game.aiWork += snakeFieldOpen(game.foodField, game.board, cell, food);
+  game.aiWork += snakeFieldOpen(game.playerField, game.board, cell, false);
+  if (!food) snakeRecord(game, cell, 0, SNAKE_NO_FOOD);
+}
+
+// Adds the head at cell and drops tail segments until size-1 are left, so each segment lasts
+// size-1 steps after the head leaves it. Records the head, any cells left empty and the
+// segments near enough the end of the tail to be fading. Cells under food or another body
+// are left to whatever is on top.
+static void snakeMoveBody(SnakeGame &game, SnakeBody &body, int cell, int size) {
+  SnakeBoard &board = game.board;
+  int dropped = snakeBodyPush(board, body, cell);
+  if (dropped >= 0) snakeEraseCell(game, dropped);
+  while (body.length > size - 1) snakeEraseCell(game, snakeBodyPop(board, body));
+  if (!game.changes) return;
+  snakeRecord(game, cell, size - 1, SNAKE_NO_FOOD);
+  // Segment t from the tail has t+1 steps left once the body is full length, more while it
+  // is still growing. Its steps left drop by at most two a step, so segments with more than
+  // SNAKE_FADE_STEPS left have not changed shade.
+  int growth = size - 1 - body.length;
+  for (int t = 0; t < body.length - 1 && t + 1 + growth <= SNAKE_FADE_STEPS; t++) {
+    int segment = snakeSegment(body, t);
+    if (board.occupied[segment] > 1 || board.food[segment] != SNAKE_NO_FOOD) continue;
+    snakeRecord(game, segment, t + 1 + growth, SNAKE_NO_FOOD);
+  }
+}
+
+static int snakeWrap(int value, int dim) {
+  value %= dim;
+  return value < 0 ? value + dim : value;
+}
+
+// Shares what is left of this step's budget, once the enemies' moves, the cells they opened
+// and the fruit still to spawn this step are paid for, between the fields in use. With enough enemies nothing is left and the
+// fields wait for a quieter step. The player's field is searched from where the player's head
+// goes next.
+static void snakeThink(SnakeGame &game) {
+  long spawning = game.foodField.distance ? game.fruits : 0;
+  long budget = std::max(game.config.aiBudget - game.aiWork - spawning, 0L);
+  bool both = game.foodField.distance && game.playerField.distance;
+  int source = game.x*game.config.ydim + game.y;
+  long work = snakeFieldWork(game.foodField, game.board, source, both ? budget/2 : budget);
+  work += snakeFieldWork(game.playerField, game.board, source, budget - work);
+  game.aiWork += work;
+}
+
+// Downhill on enemy k's field into a free cell, ties broken at random. Wanders as before
+// when the field has nothing to offer: no target it can reach, or no free cell next to it.
+static int snakeEnemyDirection(SnakeGame &game, int k) {
+  const SnakeEnemies &enemies = game.enemies;
+  const SnakeField *field = NULL;
+  if (enemies.ais[k] == SNAKE_AI_FOOD) field = &game.foodField;
+  else if (enemies.ais[k] == SNAKE_AI_PLAYER) field = &game.playerField;
+  if (field && field->distance) {
+    const SnakeBoard &board = game.board;
+    int cell = enemies.heads[k];
+    uint16_t best = SNAKE_FAR;
+    int choice = -1, ties = 0;
+    for (int d = 0; d < SNAKE_NUM_DIRECTIONS; d++) {
+      int next = snakeNeighbour(board, cell, d);
+      if (board.occupied[next] > 0) continue;
+      uint16_t distance = field->distance[next];
+      if (distance < best) {
+        best = distance;
+        choice = d;
+        ties = 1;
+      } else if (distance == best && best != SNAKE_FAR && snakeRandom(game, 0, ++ties) == 0) {
+        choice = d;
+      }
+    }
+    if (best != SNAKE_FAR) return choice;
+  }
+  return snakeWrap(enemies.directions[k] + snakeRandom(game, -1, 2), SNAKE_NUM_DIRECTIONS);
+}
+
+// Every array at once, so one failure leaves nothing half allocated. Rings hold the whole
+// board unless enemyLength says otherwise.
+static bool snakeEnemiesBegin(SnakeEnemies &enemies, const SnakeConfig &config) {
+  int cells = config.xdim * config.ydim;
+  int count = std::max(config.enemies, 0);
+  enemies.count = 0;
+  enemies.ringSize = config.enemyLength > 0 ? std::min(config.enemyLength, cells) : cells;
+  enemies.rings = (uint32_t *)malloc((size_t)count * enemies.ringSize * sizeof(uint32_t));
+  enemies.bodies = (SnakeBody *)malloc(count * sizeof(SnakeBody));
+  enemies.heads = (uint32_t *)malloc(count * sizeof(uint32_t));
+  enemies.sizes = (uint32_t *)malloc(count * sizeof(uint32_t));
+  enemies.directions = (uint8_t *)malloc(count * sizeof(uint8_t));
+  enemies.ais = (uint8_t *)malloc(count * sizeof(uint8_t));
+  if (count > 0 && (!enemies.rings || !enemies.bodies || !enemies.heads || !enemies.sizes ||
+                    !enemies.directions || !enemies.ais)) {
+    return false;
+  }
+  enemies.count = count;
+  return true;
+}
+
+static void snakeEnemiesEnd(SnakeEnemies &enemies) {
+  free(enemies.rings);
+  free(enemies.bodies);
+  free(enemies.heads);
+  free(enemies.sizes);
+  free(enemies.directions);
+  free(enemies.ais);
+  enemies = SnakeEnemies();
+}
+
+bool snakeBegin(SnakeGame &game, const SnakeConfig &config) {
+  game.config = config;
+  int cells = config.xdim * config.ydim;
+  bool ok = snakeBoardBegin(game.board, config.xdim, config.ydim);
+  ok = snakeBodyBegin(game.player, cells) && ok;
+  game.x = config.xdim/2 + 1;
+  game.y = 0;
+  SnakeEnemies &enemies = game.enemies;
+  ok = snakeEnemiesBegin(enemies, config) && ok;
+  if (cells + (long)enemies.count * enemies.ringSize > SNAKE_MAX_SEGMENTS) ok = false;
+  bool chaseFood = false, chasePlayer = false;
+  for (int k = 0; k < enemies.count; k++) {
+    snakeBodyInit(enemies.bodies[k], enemies.rings + (size_t)k * enemies.ringSize, enemies.ringSize);
+    // The first enemy starts where it always did, any others evenly spaced through the cells
+    // after it, but never in the column the player starts down
+    int cell = (2*config.ydim + config.ydim/2 + 1 + (long)k * cells / enemies.count) % cells;
+    if (cell / config.ydim == game.x) cell = (cell + config.ydim) % cells;
+    enemies.heads[k] = cell;
+    enemies.directions[k] = 0;
+    enemies.sizes[k] = std::min(config.enemySize, enemies.ringSize + 1);
+    enemies.ais[k] = config.ai;
+    if (config.ai == SNAKE_AI_MIXED) enemies.ais[k] = k % 2 == 0 ? SNAKE_AI_FOOD : SNAKE_AI_PLAYER;
+    chaseFood = chaseFood || enemies.ais[k] == SNAKE_AI_FOOD;
+    chasePlayer = chasePlayer || enemies.ais[k] == SNAKE_AI_PLAYER;
+  }
+  game.foodField = SnakeField();
+  game.playerField = SnakeField();
+  if (chaseFood) ok = snakeFieldBegin(game.foodField, SNAKE_TARGET_FOOD, cells) && ok;
+  if (chasePlayer) ok = snakeFieldBegin(game.playerField, SNAKE_TARGET_PLAYER, cells) && ok;
+  game.aiWork = 0;
+  game.size = config.size;
+  game.period = config.stepSize;
+  game.timer = config.defaultTimer;
+  game.round = 0;
+  game.fruits = 1;
+  game.slowdown = game.speedup = game.invincible = 0;
+  game.treasure = 75;
+  game.millis = game.roundMillis = 0;
+  game.steps = 0;
+  game.over = false;
+  game.random = config.seed ? config.seed : 1;
+  // Each snake reports its head, up to three cells it left and its fading segments, and a
+  // few fruits may spawn
+  game.numChanges = 0;
+  game.maxChanges = SNAKE_FADE_STEPS + 4 + enemies.count * (std::min(enemies.ringSize, SNAKE_FADE_STEPS) + 4) + 8;
+  game.changes = NULL;
+  if (config.record) {
+    game.changes = (SnakeChange *)malloc(game.maxChanges * sizeof(SnakeChange));
+    if (!game.changes) ok = false;
+  }
+  if (!ok) return false;
+  snakeSpawnFruit(game);
+  return true;
+}
+
+void snakeEnd(SnakeGame &game) {
+  snakeEnemiesEnd(game.enemies);
+  snakeBodyEnd(game.player);
+  snakeBoardEnd(game.board);
+  snakeFieldEnd(game.foodField);
+  snakeFieldEnd(game.playerField);
+  free(game.changes);
+  game.changes = NULL;
+}
+
+void snakeStep(SnakeGame &game, int buttons) {
+  if (game.over) return;
+  const SnakeConfig &config = game.config;
+  SnakeBoard &board = game.board;
+  game.numChanges = 0;
+  game.aiWork = 0;
+  game.millis += game.period;
+  game.steps++;
+  while (game.millis - game.roundMillis > (unsigned long)config.stepSize) {
+    game.round++;
+    game.roundMillis += config.stepSize;
+    snakeSpeedUp(game);
+  }
+
+  // Cyan fruit protects until the first crash, then wears off
+  if (game.invincible > 0 && game.invincible != config.invincibility) game.invincible--;
+  int cell = game.x*config.ydim + game.y;
+  int food = board.food[cell];
+  SnakeEnemies &enemies = game.enemies;
+  for (int k = 0; k < enemies.count; k++) {
+    if (board.food[enemies.heads[k]] == SNAKE_NO_FOOD) continue;
+    if ((int)enemies.sizes[k] <= enemies.ringSize) enemies.sizes[k]++;
+    game.fruits++;
+  }
+  if (food != SNAKE_NO_FOOD) {
+    game.size += 1;
+    if (food == SNAKE_FOOD_GREENYELLOW) {
+      game.slowdown = 10;
+    } else if (food == SNAKE_FOOD_CYAN) {
+      game.invincible = config.invincibility;
+      game.speedup = 5;
+    } else if (food == SNAKE_FOOD_GOLD) {
+      if (game.period <= 50) game.size += 55 - game.period;
+      else game.size += 4;
+      if (game.treasure < 95) game.fruits++;
+    }
+    game.fruits++;
+  } else if (board.occupied[cell] > 0) {
+    if (game.invincible == 0) {
+      game.over = true;
+      return;
+    }
+    game.invincible--;
+    game.size = std::max(SNAKE_MIN_SIZE, game.size - 1);
+  }
+
+  // Whatever a head lands on is eaten. The player moves last, so it is on top where they meet.
+  for (int k = 0; k < enemies.count; k++) {
+    snakeBoardSetFood(board, enemies.heads[k], SNAKE_NO_FOOD);
+    snakeMoveBody(game, enemies.bodies[k], enemies.heads[k], enemies.sizes[k]);
+  }
+  game.aiWork += (long)enemies.count * SNAKE_ENEMY_WORK;
+  snakeBoardSetFood(board, cell, SNAKE_NO_FOOD);
+  snakeMoveBody(game, game.player, cell, game.size);
+
+  int direction = snakeButtonDir[buttons & (SNAKE_LEFT | SNAKE_RIGHT)];
+  game.x = snakeWrap(game.x + snakeXDir[direction], config.xdim);
+  game.y = snakeWrap(game.y + snakeYDir[direction], config.ydim);
+  snakeThink(game);
+  for (int k = 0; k < enemies.count; k++) {
+    enemies.directions[k] = snakeEnemyDirection(game, k);
+    enemies.heads[k] = snakeNeighbour(board, enemies.heads[k], enemies.directions[k]);
+  }
+
+  snakeSpawnFruit(game);
+  snakeSpeedUp(game);
+}
@@ -0,0 +1,123 @@
+// Snake rules
+// The whole game as a deterministic step function: no clock, pins, screen or global random().
+// Time is counted in virtual milliseconds that advance by the current period each step,
+// random numbers come from a seeded generator in the game and the buttons are passed in, so
+// the same seed and inputs always play out the same way on the board and on the host.
+#ifndef SNAKE_H
+#define SNAKE_H
+
+#include <stdint.h>
+#include "snake_board.h"
+#include "snake_ai.h"
+
+#define SNAKE_NUM_DIRECTIONS 4
+// Segments are reported to the renderer while they have fewer than this many steps left,
+// after which they are drawn plain white
+#define SNAKE_FADE_STEPS 32
+
+// Buttons held during a step. Neither moves down the board, one moves towards its side and
+// both move up.
+#define SNAKE_LEFT 1
+#define SNAKE_RIGHT 2
+
+// How enemies pick their way
+enum SnakeAi {
+  SNAKE_AI_WANDER,  // turn at random, as they always have
+  SNAKE_AI_FOOD,    // head for the nearest food
+  SNAKE_AI_PLAYER,  // head for the player
+  SNAKE_AI_MIXED    // alternate enemies do each, starting with food
+};
+
+// Food kinds in the board's food layer
+enum SnakeFood {
+  SNAKE_FOOD_RED = 1,    // grows by one
+  SNAKE_FOOD_GREENYELLOW, // slows the game down for a while
+  SNAKE_FOOD_CYAN,       // invincible until the next crash, then for a while after it
+  SNAKE_FOOD_GOLD,       // grows more the faster the game is going
+  SNAKE_FOOD_KINDS
+};
+
+struct SnakeConfig {
+  int xdim, ydim;
+  int enemies;            // any number, from none to hundreds, while the player's board-sized
+                          // ring and the enemies' rings hold at most SNAKE_MAX_SEGMENTS
+  int enemyLength;        // most segments an enemy grows to, 0 for the whole board
+  int ai;                 // SnakeAi for the enemies
+  long aiBudget;          // units of snakeFieldWork() per step across both fields, less
+                          // what the enemies' moves and the cells they open cost
+  uint32_t seed;
+  bool record;            // keep the cells each step changes, for a renderer
+  // Speed curve, all in virtual milliseconds
+  int stepSize;           // length of one round
+  int defaultTimer;       // rounds between speed-ups, scaled by the period
+  int periodDec;          // taken off the period at each speed-up
+  int periodInc;          // added back for every fruit spawned
+  int maxPeriod, minPeriod;
+  int invincibility;      // steps of invincibility from a cyan fruit
+  int size, enemySize;    // starting lengths
+};
+
+// A cell whose contents changed this step. stepsLeft is how long the body segment now on it
+// has to go, 0 once the cell is empty, and food is set instead if food lies there.
+struct SnakeChange {
+  uint32_t cell;
+  uint16_t stepsLeft;
+  uint8_t food;
+};
+
+// Every enemy, an array per field, so each pass of a step runs down only the arrays it uses.
+// The bodies' rings are slices of one block.
+struct SnakeEnemies {
+  int count;
+  int ringSize;           // segments each ring holds, enemies stop growing at ringSize+1
+  uint32_t *rings;
+  SnakeBody *bodies;
+  uint32_t *heads;        // cell each head is added at next step
+  uint32_t *sizes;
+  uint8_t *directions;
+  uint8_t *ais;           // SNAKE_AI_WANDER, SNAKE_AI_FOOD or SNAKE_AI_PLAYER
+};
+
+struct SnakeGame {
+  SnakeConfig config;
+  SnakeBoard board;
+  SnakeBody player;
+  int x, y;               // cell the player's head will be added at next step
+  int size;
+  SnakeEnemies enemies;
+  // Distance fields, allocated only when some enemy follows them
+  SnakeField foodField, playerField;
+  long aiWork;            // units the last step charged to aiBudget
+  // Speed curve state, as the sketch always had it
+  int period, timer, round;
+  int fruits, slowdown, speedup, invincible, treasure;
+  unsigned long millis;   // virtual time of the last step
+  unsigned long roundMillis;
+  unsigned long steps;
+  bool over;
+  uint32_t random;
+  SnakeChange *changes;
+  int numChanges, maxChanges;
+};
+
+// The board, speed curve and starting lengths the game has always used, one wandering enemy,
+// no recording
+void snakeDefaultConfig(SnakeConfig &config);
+
+// The default speed curve on a board of half-size cells, 34x64 on the panel, crawling with
+// 120 short wandering enemies
+void snakeSwarmConfig(SnakeConfig &config);
+
+// Sets up a new game and spawns the first fruit. Returns false if memory ran out.
+bool snakeBegin(SnakeGame &game, const SnakeConfig &config);
+void snakeEnd(SnakeGame &game);
+
+// Plays one step with the given buttons held, then spawns fruit and updates the speed curve.
+// The step is due game.period milliseconds after the previous one. Sets game.over when the
+// player crashes without invincibility, after which steps do nothing.
+void snakeStep(SnakeGame &game, int buttons);
+
+// Seeded generator behind every random choice in the game, lo <= result < hi like random()
+int snakeRandom(SnakeGame &game, int lo, int hi);
+
+#endif
@@ -0,0 +1,128 @@
+// Snake pathfinding
+#include "snake_ai.h"
+#include <stdlib.h>
+
+#define SNAKE_EVENT_TARGET 0x80000000u
+
+bool snakeFieldBegin(SnakeField &field, int target, int cells) {
+  field.target = target;
+  field.cells = cells;
+  field.distance = (uint16_t *)malloc(cells * sizeof(uint16_t));
+  field.building = (uint16_t *)malloc(cells * sizeof(uint16_t));
+  field.queue = (uint32_t *)malloc(cells * sizeof(uint32_t));
+  field.pending = (uint32_t *)malloc(cells * sizeof(uint32_t));
+  field.queued = (uint8_t *)calloc(cells, sizeof(uint8_t));
+  field.queueHead = field.queueTail = 0;
+  field.scan = 0;
+  field.pendingHead = field.pendingCount = 0;
+  field.numEvents = 0;
+  field.rebuilds = 0;
+  if (!field.distance || !field.building || !field.queue || !field.pending || !field.queued) {
+    snakeFieldEnd(field);
+    return false;
+  }
+  for (int k = 0; k < cells; k++) field.distance[k] = SNAKE_FAR;
+  return true;
+}
+
+void snakeFieldEnd(SnakeField &field) {
+  free(field.distance);
+  free(field.building);
+  free(field.queue);
+  free(field.pending);
+  free(field.queued);
+  field.distance = field.building = NULL;
+  field.queue = field.pending = NULL;
+  field.queued = NULL;
+}
+
+static void snakeFieldLower(SnakeField &field, int cell, uint16_t distance) {
+  if (distance >= field.distance[cell]) return;
+  field.distance[cell] = distance;
+  if (field.queued[cell]) return;
+  int k = field.pendingHead + field.pendingCount;
+  if (k >= field.cells) k -= field.cells;
+  field.pending[k] = cell;
+  field.pendingCount++;
+  field.queued[cell] = 1;
+}
+
+// One less than the nearest of its neighbours, as far as the live field knows
+static uint16_t snakeFieldReach(const SnakeField &field, const SnakeBoard &board, int cell) {
+  uint16_t best = SNAKE_FAR;
+  for (int d = 0; d < 4; d++) {
+    uint16_t distance = field.distance[snakeNeighbour(board, cell, d)];
+    if (distance < best) best = distance;
+  }
+  return best == SNAKE_FAR ? SNAKE_FAR : best + 1;
+}
+
+static void snakeFieldSeed(SnakeField &field, const SnakeBoard &board, int cell, bool target) {
+  snakeFieldLower(field, cell, target ? 0 : snakeFieldReach(field, board, cell));
+}
+
+long snakeFieldOpen(SnakeField &field, const SnakeBoard &board, int cell, bool target) {
+  if (!field.distance) return 0;
+  snakeFieldSeed(field, board, cell, target);
+  // The rebuild may already have been past this cell, so it gets the same news when it is done.
+  // Any beyond SNAKE_FIELD_EVENTS wait for the rebuild after.
+  if (field.numEvents < SNAKE_FIELD_EVENTS) field.events[field.numEvents++] = cell | (target ? SNAKE_EVENT_TARGET : 0);
+  return 1;
+}
+
+long snakeFieldWork(SnakeField &field, const SnakeBoard &board, int source, long budget) {
+  if (!field.distance) return 0;
+  long work = 0;
+  // Drops spread outwards first, they are what makes new food worth chasing at once
+  while (field.pendingCount > 0 && work < budget) {
+    int cell = field.pending[field.pendingHead];
+    if (++field.pendingHead == field.cells) field.pendingHead = 0;
+    field.pendingCount--;
+    field.queued[cell] = 0;
+    work++;
+    // A rebuild may have been swapped in since it was queued
+    if (field.distance[cell] == SNAKE_FAR) continue;
+    uint16_t next = field.distance[cell] + 1;
+    for (int d = 0; d < 4; d++) {
+      int neighbour = snakeNeighbour(board, cell, d);
+      if (board.occupied[neighbour] == 0) snakeFieldLower(field, neighbour, next);
+    }
+  }
+
+  uint16_t *building = field.building;
+  if (field.scan == 0) field.queueHead = field.queueTail = 0;
+  while (field.scan < field.cells && work < budget) {
+    int cell = field.scan++;
+    bool target = field.target == SNAKE_TARGET_FOOD ? board.food[cell] != SNAKE_NO_FOOD : cell == source;
+    building[cell] = target ? 0 : SNAKE_FAR;
+    if (target) field.queue[field.queueTail++] = cell;
+    work++;
+  }
+  while (field.scan == field.cells && field.queueHead < field.queueTail && work < budget) {
+    int cell = field.queue[field.queueHead++];
+    uint16_t next = building[cell] + 1;
+    for (int d = 0; d < 4; d++) {
+      int neighbour = snakeNeighbour(board, cell, d);
+      if (building[neighbour] == SNAKE_FAR && board.occupied[neighbour] == 0) {
+        building[neighbour] = next;
+        field.queue[field.queueTail++] = neighbour;
+      }
+    }
+    work++;
+  }
+
+  if (field.scan == field.cells && field.queueHead == field.queueTail) {
+    // Done: swap it in, pass on what changed while it was being built and start over
+    field.building = field.distance;
+    field.distance = building;
+    for (int k = 0; k < field.numEvents; k++) {
+      uint32_t event = field.events[k];
+      snakeFieldSeed(field, board, event & ~SNAKE_EVENT_TARGET, event & SNAKE_EVENT_TARGET);
+    }
+    work += field.numEvents;
+    field.numEvents = 0;
+    field.scan = 0;
+    field.rebuilds++;
+  }
+  return work;
+}
@@ -0,0 +1,71 @@
+// Snake pathfinding
+// Distance fields for enemies to follow downhill: steps from every cell to the nearest target
+// on the toroidal board, going around bodies. A field is rebuilt by breadth-first search a
+// slice at a time, so a step never does more than its budget of work, and cells that become
+// targets or free up in between are spread through the live field straight away. Cells that
+// become blocked are only seen by the next rebuild, so a field can lead into a body that has
+// moved in since; whoever follows it checks the next cell themselves.
+#ifndef SNAKE_AI_H
+#define SNAKE_AI_H
+
+#include <stdint.h>
+#include "snake_board.h"
+
+#define SNAKE_FAR 0xffff       // distance of cells no target can be reached from
+#define SNAKE_FIELD_EVENTS 256 // cells opened during a rebuild, replayed into it once it is done
+#define SNAKE_UNLIMITED 0x7fffffffL // a budget that always lets a rebuild finish in one step
+
+// What a field measures the distance to
+enum SnakeTarget {
+  SNAKE_TARGET_FOOD,   // every cell with food on it
+  SNAKE_TARGET_PLAYER  // the cell the player's head moves into next
+};
+
+struct SnakeField {
+  int target;
+  int cells;
+  uint16_t *distance;  // the live field
+  uint16_t *building;  // the next one, part built
+  // Rebuild: cells are scanned for targets and reset, then the search runs off the queue
+  uint32_t *queue;
+  int queueHead, queueTail;
+  int scan;            // next cell to scan, cells once the search has started
+  // Cells whose distance dropped and still have to pass it on, a ring with no duplicates
+  uint32_t *pending;
+  uint8_t *queued;
+  int pendingHead, pendingCount;
+  // Cells opened since the rebuild started, the top bit set for targets
+  uint32_t events[SNAKE_FIELD_EVENTS];
+  int numEvents;
+  unsigned long rebuilds; // completed since snakeFieldBegin(), for reports
+};
+
+// A field with nothing reachable, whose first rebuild starts with the first snakeFieldWork().
+// Returns false if memory ran out.
+bool snakeFieldBegin(SnakeField &field, int target, int cells);
+void snakeFieldEnd(SnakeField &field);
+
+// cell has just become free, and a target if target is set: lowers the distances around it
+// without waiting for a rebuild. Costs one unit, returned so the caller can charge it to the
+// step's budget; the spreading is done by snakeFieldWork().
+long snakeFieldOpen(SnakeField &field, const SnakeBoard &board, int cell, bool target);
+
+// Does up to budget units of work, a unit being one cell scanned or searched from: first the
+// pending drops, then the rebuild. source is the player's next cell for SNAKE_TARGET_PLAYER,
+// taken when a rebuild starts. A finished rebuild replaces the live field and the next one
+// starts on the next call, after replaying the cells opened meanwhile at a unit each, which
+// can take the call over budget by up to SNAKE_FIELD_EVENTS. Returns the units done.
+long snakeFieldWork(SnakeField &field, const SnakeBoard &board, int source, long budget);
+
+// Cell one step from cell in each of the four directions, wrapping round the board
+inline int snakeNeighbour(const SnakeBoard &board, int cell, int direction) {
+  int x = cell / board.ydim, y = cell - x*board.ydim;
+  switch (direction) {
+    case 0: return y+1 == board.ydim ? cell - y : cell + 1;
+    case 1: return x+1 == board.xdim ? y : cell + board.ydim;
+    case 2: return y == 0 ? cell + board.ydim-1 : cell - 1;
+    default: return x == 0 ? (board.xdim-1)*board.ydim + y : cell - board.ydim;
+  }
+}
+
+#endif
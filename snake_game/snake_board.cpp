@@ -0,0 +1,95 @@
+// Snake board model
+#include "snake_board.h"
+#include <assert.h>
+#include <stdlib.h>
+
+bool snakeBoardBegin(SnakeBoard &board, int xdim, int ydim) {
+  int cells = xdim * ydim;
+  board.xdim = xdim;
+  board.ydim = ydim;
+  board.occupied = (uint16_t *)calloc(cells, sizeof(uint16_t));
+  board.food = (uint8_t *)calloc(cells, sizeof(uint8_t));
+  board.freeCells = (uint32_t *)malloc(cells * sizeof(uint32_t));
+  board.freeIndex = (uint32_t *)malloc(cells * sizeof(uint32_t));
+  board.numFree = 0;
+  if (!board.occupied || !board.food || !board.freeCells || !board.freeIndex) return false;
+  for (int k = 0; k < cells; k++) board.freeCells[k] = board.freeIndex[k] = k;
+  board.numFree = cells;
+  return true;
+}
+
+void snakeBoardEnd(SnakeBoard &board) {
+  free(board.occupied);
+  free(board.food);
+  free(board.freeCells);
+  free(board.freeIndex);
+  board.occupied = NULL;
+  board.food = NULL;
+  board.freeCells = board.freeIndex = NULL;
+  board.numFree = 0;
+}
+
+static void snakeFreeAdd(SnakeBoard &board, int cell) {
+  board.freeIndex[cell] = board.numFree;
+  board.freeCells[board.numFree++] = cell;
+}
+
+// The last free cell fills the gap, so the set stays packed
+static void snakeFreeRemove(SnakeBoard &board, int cell) {
+  int k = board.freeIndex[cell];
+  int last = board.freeCells[--board.numFree];
+  board.freeCells[k] = last;
+  board.freeIndex[last] = k;
+}
+
+void snakeBoardSetFood(SnakeBoard &board, int cell, int food) {
+  bool wasFree = snakeCellFree(board, cell);
+  board.food[cell] = food;
+  bool isFree = snakeCellFree(board, cell);
+  if (wasFree && !isFree) snakeFreeRemove(board, cell);
+  else if (isFree && !wasFree) snakeFreeAdd(board, cell);
+}
+
+bool snakeBodyBegin(SnakeBody &body, int capacity) {
+  uint32_t *cells = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+  snakeBodyInit(body, cells, cells ? capacity : 0);
+  return cells != NULL;
+}
+
+void snakeBodyInit(SnakeBody &body, uint32_t *cells, int capacity) {
+  body.cells = cells;
+  body.capacity = capacity;
+  body.tail = 0;
+  body.length = 0;
+}
+
+void snakeBodyEnd(SnakeBody &body) {
+  free(body.cells);
+  body.cells = NULL;
+  body.capacity = body.length = 0;
+}
+
+int snakeBodyPush(SnakeBoard &board, SnakeBody &body, int cell) {
+  if (body.capacity == 0) return -1;
+  int dropped = body.length == body.capacity ? snakeBodyPop(board, body) : -1;
+  int k = body.tail + body.length;
+  if (k >= body.capacity) k -= body.capacity;
+  body.cells[k] = cell;
+  body.length++;
+  if (snakeCellFree(board, cell)) snakeFreeRemove(board, cell);
+  // Cannot fire while the bodies hold no more than SNAKE_MAX_SEGMENTS between them
+  assert(board.occupied[cell] < SNAKE_MAX_SEGMENTS);
+  board.occupied[cell]++;
+  return dropped;
+}
+
+int snakeBodyPop(SnakeBoard &board, SnakeBody &body) {
+  if (body.length == 0) return -1;
+  int cell = body.cells[body.tail];
+  if (++body.tail == body.capacity) body.tail = 0;
+  body.length--;
+  assert(board.occupied[cell] > 0);
+  board.occupied[cell]--;
+  if (snakeCellFree(board, cell)) snakeFreeAdd(board, cell);
+  return cell;
+}
@@ -0,0 +1,70 @@
+// Snake board model
+// Each snake's body is a ring buffer of the cells it covers, oldest first, and the board keeps
+// separate byte layers for how many segments cover each cell and what food lies there, plus
+// the set of cells with neither. Moving a snake pushes one cell and pops one or two, so a step
+// costs the same on any size of board.
+#ifndef SNAKE_BOARD_H
+#define SNAKE_BOARD_H
+
+#include <stdint.h>
+
+#define SNAKE_NO_FOOD 0
+// Most segments all the bodies on a board may hold between them, which is as many as could
+// ever cover one cell, so the occupied counts cannot overflow. snakeBegin() refuses more.
+#define SNAKE_MAX_SEGMENTS 0xffff
+
+// Cells are numbered x*ydim + y, the order of the old grid[x][y]
+struct SnakeBoard {
+  int xdim, ydim;
+  uint16_t *occupied; // segments covering each cell, more than one where bodies cross
+  uint8_t *food;     // kind of food in each cell, SNAKE_NO_FOOD where there is none
+  // Free cells, with no segment or food, packed in no particular order, and where each free
+  // cell sits in freeCells. Kept up to date by every push, pop and snakeBoardSetFood().
+  uint32_t *freeCells;
+  uint32_t *freeIndex;
+  int numFree;
+};
+
+struct SnakeBody {
+  uint32_t *cells;   // ring of cells, the tail at cells[tail]
+  int capacity;
+  int tail;
+  int length;
+};
+
+// Both return false if the layers or the ring cannot be allocated
+bool snakeBoardBegin(SnakeBoard &board, int xdim, int ydim);
+void snakeBoardEnd(SnakeBoard &board);
+bool snakeBodyBegin(SnakeBody &body, int capacity);
+void snakeBodyEnd(SnakeBody &body);
+
+// An empty body over a ring the caller owns, for snakes that share one block. Not for
+// snakeBodyEnd().
+void snakeBodyInit(SnakeBody &body, uint32_t *cells, int capacity);
+
+// Puts food on a cell, or clears it with SNAKE_NO_FOOD. Always use this rather than writing
+// to the food layer, so the free cells stay right.
+void snakeBoardSetFood(SnakeBoard &board, int cell, int food);
+
+inline bool snakeCellFree(const SnakeBoard &board, int cell) {
+  return board.occupied[cell] == 0 && board.food[cell] == SNAKE_NO_FOOD;
+}
+
+// Adds a new head at cell. A full ring drops its tail first, which is returned, -1 otherwise.
+int snakeBodyPush(SnakeBoard &board, SnakeBody &body, int cell);
+
+// Removes the tail and returns its cell, or -1 if the body is empty
+int snakeBodyPop(SnakeBoard &board, SnakeBody &body);
+
+// Cell of segment t counting from the tail, so the head is segment length-1
+inline int snakeSegment(const SnakeBody &body, int t) {
+  int k = body.tail + t;
+  if (k >= body.capacity) k -= body.capacity;
+  return body.cells[k];
+}
+
+inline int snakeHead(const SnakeBody &body) {
+  return snakeSegment(body, body.length - 1);
+}
+
+#endif
@@ -0,0 +1,138 @@
+// Snake autopilot
+#include "snake_bot.h"
+#include <stdlib.h>
+
+// Buttons that move in each direction, the other way round from snakeButtonDir in snake.cpp
+static const int snakeBotButtonsFor[SNAKE_NUM_DIRECTIONS] = {0, SNAKE_RIGHT, SNAKE_LEFT | SNAKE_RIGHT, SNAKE_LEFT};
+
+bool snakeBotBegin(SnakeBot &bot, int cells, long budget) {
+  bot.cells = cells;
+  bot.budget = budget;
+  bot.queue = (uint32_t *)malloc(cells * sizeof(uint32_t));
+  bot.distance = (uint16_t *)malloc(cells * sizeof(uint16_t));
+  bot.seen = (uint32_t *)calloc(cells, sizeof(uint32_t));
+  bot.search = 0;
+  bot.work = 0;
+  bot.direction = 0;
+  bot.decisions = bot.cycleMoves = bot.unsafeMoves = 0;
+  if (!bot.queue || !bot.distance || !bot.seen) {
+    snakeBotEnd(bot);
+    return false;
+  }
+  return true;
+}
+
+void snakeBotEnd(SnakeBot &bot) {
+  free(bot.queue);
+  free(bot.distance);
+  free(bot.seen);
+  bot.queue = bot.seen = NULL;
+  bot.distance = NULL;
+}
+
+// Boustrophedon along whichever side is even, which closes up into a cycle through every
+// cell of the torus. -1 when both sides are odd and there is none this simple.
+static int snakeBotCycle(const SnakeBoard &board, int cell) {
+  int x = cell / board.ydim, y = cell - x*board.ydim;
+  if (board.ydim % 2 == 0) {
+    if (y % 2 == 0) return x == board.xdim - 1 ? 0 : 1;
+    return x == 0 ? 0 : 3;
+  }
+  if (board.xdim % 2 == 0) {
+    if (x % 2 == 0) return y == board.ydim - 1 ? 1 : 0;
+    return y == 0 ? 1 : 2;
+  }
+  return -1;
+}
+
+// Starts a new search with the cells that will be covered after this step already reached:
+// where the head is now and where each enemy is about to add its head. Tails that move off
+// are not counted on.
+static uint32_t snakeBotMark(SnakeBot &bot, const SnakeGame &game, int from) {
+  if (++bot.search == 0) {
+    for (int k = 0; k < bot.cells; k++) bot.seen[k] = 0;
+    bot.search = 1;
+  }
+  for (int k = 0; k < game.enemies.count; k++) bot.seen[game.enemies.heads[k]] = bot.search;
+  bot.seen[from] = bot.search;
+  return bot.search;
+}
+
+struct SnakeBotMove {
+  int region;             // cells reached, at least this many if the search ran out of budget
+  int food;               // steps to the nearest food, SNAKE_FAR if none was reached
+};
+
+// Breadth-first from start, the head's next cell, over free cells until the budget runs out or
+// the region is known to be big enough and the nearest food has been found
+static SnakeBotMove snakeBotSearch(SnakeBot &bot, const SnakeGame &game, int from, int start, int need, long budget) {
+  const SnakeBoard &board = game.board;
+  uint32_t search = snakeBotMark(bot, game, from);
+  SnakeBotMove move = {0, SNAKE_FAR};
+  int head = 0, tail = 0;
+  bot.seen[start] = search;
+  bot.distance[start] = 0;
+  bot.queue[tail++] = start;
+  while (head < tail && budget > 0) {
+    int cell = bot.queue[head++];
+    budget--;
+    bot.work++;
+    move.region++;
+    if (move.food == SNAKE_FAR && board.food[cell] != SNAKE_NO_FOOD) move.food = bot.distance[cell];
+    if (move.region >= need && move.food != SNAKE_FAR) break;
+    for (int d = 0; d < SNAKE_NUM_DIRECTIONS; d++) {
+      int next = snakeNeighbour(board, cell, d);
+      if (bot.seen[next] == search || board.occupied[next] > 0) continue;
+      bot.seen[next] = search;
+      bot.distance[next] = bot.distance[cell] + 1;
+      bot.queue[tail++] = next;
+    }
+  }
+  return move;
+}
+
+int snakeBotButtons(SnakeBot &bot, const SnakeGame &game) {
+  bot.work = 0;
+  if (game.over) return 0;
+  const SnakeBoard &board = game.board;
+  int cell = game.x*board.ydim + game.y;
+  uint32_t search = snakeBotMark(bot, game, cell);
+  int open[SNAKE_NUM_DIRECTIONS], numOpen = 0;
+  for (int d = 0; d < SNAKE_NUM_DIRECTIONS; d++) {
+    int next = snakeNeighbour(board, cell, d);
+    if (bot.seen[next] != search && board.occupied[next] == 0) open[numOpen++] = d;
+  }
+
+  SnakeBotMove moves[SNAKE_NUM_DIRECTIONS];
+  int cycle = snakeBotCycle(board, cell);
+  int best = -1;
+  bool safe = false;
+  for (int i = 0; i < numOpen; i++) {
+    int d = open[i];
+    moves[d] = snakeBotSearch(bot, game, cell, snakeNeighbour(board, cell, d), game.size, bot.budget / numOpen);
+  }
+  for (int i = 0; i < numOpen; i++) {
+    int d = open[i];
+    bool fits = moves[d].region >= game.size;
+    if (best < 0 || (fits && !safe)) {
+      best = d;
+      safe = fits;
+      continue;
+    }
+    if (fits != safe) continue;
+    const SnakeBotMove &a = moves[d], &b = moves[best];
+    if (safe && a.food != b.food) {
+      if (a.food < b.food) best = d;
+    } else if (d == cycle || (best != cycle && a.region > b.region)) {
+      // Level on food, or nothing safe: the cycle, then the most room
+      best = d;
+    }
+  }
+  if (numOpen > 0 && !safe) {
+    bot.unsafeMoves++;
+    if (best == cycle) bot.cycleMoves++;
+  }
+  bot.decisions++;
+  bot.direction = best >= 0 ? best : (cycle >= 0 ? cycle : 0);
+  return snakeBotButtonsFor[bot.direction];
+}
@@ -0,0 +1,34 @@
+// Snake autopilot
+// Plays the player's side of the game in place of the buttons, for soak runs and benchmarks.
+// Each step it flood-fills the board from every cell the head could move to next: a move is
+// safe if the space it opens onto can hold the whole body, and the safe move nearest food
+// wins. With no safe move it follows a Hamiltonian cycle of the board where there is one, and
+// otherwise takes whichever move leaves the most room. The searches share a budget of work,
+// so a decision takes no longer on a big board than the budget allows.
+#ifndef SNAKE_BOT_H
+#define SNAKE_BOT_H
+
+#include <stdint.h>
+#include "snake.h"
+
+struct SnakeBot {
+  int cells;
+  long budget;            // cells searched per decision, across all the moves
+  uint32_t *queue;
+  uint16_t *distance;
+  uint32_t *seen;         // search that last reached each cell, so nothing is cleared between
+  uint32_t search;
+  // Reports
+  long work;              // cells searched by the last decision
+  int direction;          // last move, 0 to 3 as snakeNeighbour() numbers them
+  unsigned long decisions, cycleMoves, unsafeMoves;
+};
+
+// Returns false if memory ran out
+bool snakeBotBegin(SnakeBot &bot, int cells, long budget);
+void snakeBotEnd(SnakeBot &bot);
+
+// Buttons to hold for the next snakeStep() of game
+int snakeBotButtons(SnakeBot &bot, const SnakeGame &game);
+
+#endif
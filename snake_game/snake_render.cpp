@@ -0,0 +1,114 @@
+// Snake board renderer
+#include "snake_render.h"
+#include <stdlib.h>
+#include <algorithm>
+
+// Not a colour the sketches draw with, it marks cells whose contents are unknown
+#define SNAKE_UNKNOWN_COLOUR 0x0821
+
+bool snakeScreenBegin(SnakeScreen &screen, int xdim, int ydim, int cell) {
+  screen.xdim = xdim;
+  screen.ydim = ydim;
+  screen.cell = cell;
+  screen.cellsDrawn = 0;
+  // calloc leaves every cell TFT_BLACK, which is what the cleared screen shows
+  screen.drawn = (uint16_t *)calloc(xdim * ydim, sizeof(uint16_t));
+  return screen.drawn != NULL;
+}
+
+void snakeScreenEnd(SnakeScreen &screen) {
+  free(screen.drawn);
+  screen.drawn = NULL;
+}
+
+void snakeScreenInvalidate(SnakeScreen &screen) {
+  if (!screen.drawn) return;
+  for (int k = 0; k < screen.xdim * screen.ydim; k++) screen.drawn[k] = SNAKE_UNKNOWN_COLOUR;
+}
+
+void snakeBatchStart(TFT_eSPI &tft) {
+  tft.startWrite();
+}
+
+void snakeBatchFinish(TFT_eSPI &tft) {
+  tft.endWrite();
+}
+
+static int snakeCornerRadius(int cell) {
+  return std::min(SNAKE_CORNER_RADIUS, (cell - 1) / 2);
+}
+
+// Records colour in the shadow, false if the cell already shows it
+static bool snakeCellChanged(SnakeScreen &screen, int x, int y, uint16_t colour) {
+  if (!screen.drawn) return true;
+  uint16_t &drawn = screen.drawn[x*screen.ydim + y];
+  if (drawn == colour) return false;
+  drawn = colour;
+  return true;
+}
+
+bool snakeDrawCell(TFT_eSPI &tft, SnakeScreen &screen, int x, int y, uint16_t colour) {
+  if (!snakeCellChanged(screen, x, y, colour)) return false;
+  int l = screen.cell;
+  tft.fillRoundRect(x*l, y*l, l, l, snakeCornerRadius(l), colour);
+  screen.cellsDrawn++;
+  return true;
+}
+
+static void snakeTileLine(uint16_t *tile, int l, int x, int y, int w, uint16_t colour) {
+  for (int i = std::max(x, 0); i < std::min(x + w, l); i++) tile[y*l + i] = colour;
+}
+
+// Same pixels as TFT_eSPI's fillRoundRect(0, 0, l, l, r): the middle band, then the top and
+// bottom corners a line at a time by the midpoint circle
+static void snakeRasterise(uint16_t *tile, int l, int r, uint16_t colour) {
+  for (int k = 0; k < l*l; k++) tile[k] = TFT_BLACK;
+  for (int y = r; y < l - r; y++) snakeTileLine(tile, l, 0, y, l, colour);
+  int f = 1 - r, ddFx = 1, ddFy = -r - r, y = 0;
+  int delta = l - r - r;
+  int x0 = r, top = r, bottom = l - r - 1;
+  while (y < r) {
+    if (f >= 0) {
+      snakeTileLine(tile, l, x0 - y, bottom + r, y + y + delta, colour);
+      snakeTileLine(tile, l, x0 - y, top - r, y + y + delta, colour);
+      r--;
+      ddFy += 2;
+      f += ddFy;
+    }
+    y++;
+    ddFx += 2;
+    f += ddFx;
+    snakeTileLine(tile, l, x0 - r, bottom + y, r + r + delta, colour);
+    snakeTileLine(tile, l, x0 - r, top - y, r + r + delta, colour);
+  }
+}
+
+bool snakeAtlasBegin(SnakeAtlas &atlas, int cell, const uint16_t *colours, int count) {
+  atlas.cell = cell;
+  atlas.numTiles = std::min(count, SNAKE_MAX_TILES);
+  for (int k = 0; k < atlas.numTiles; k++) atlas.colours[k] = colours[k];
+  atlas.pixels = (uint16_t *)malloc(atlas.numTiles * cell * cell * sizeof(uint16_t));
+  if (!atlas.pixels) return false;
+  for (int k = 0; k < atlas.numTiles; k++) {
+    uint16_t *tile = atlas.pixels + k*cell*cell;
+    snakeRasterise(tile, cell, snakeCornerRadius(cell), colours[k]);
+    // pushImage() sends the buffer as it lies in memory, high byte first to the panel
+    for (int p = 0; p < cell*cell; p++) tile[p] = tile[p] << 8 | tile[p] >> 8;
+  }
+  return true;
+}
+
+void snakeAtlasEnd(SnakeAtlas &atlas) {
+  free(atlas.pixels);
+  atlas.pixels = NULL;
+  atlas.numTiles = 0;
+}
+
+bool snakeDrawTile(TFT_eSPI &tft, SnakeScreen &screen, const SnakeAtlas &atlas, int x, int y, int tile) {
+  if (!atlas.pixels) return snakeDrawCell(tft, screen, x, y, atlas.colours[tile]);
+  if (!snakeCellChanged(screen, x, y, atlas.colours[tile])) return false;
+  int l = atlas.cell;
+  tft.pushImage(x*l, y*l, l, l, atlas.pixels + tile*l*l);
+  screen.cellsDrawn++;
+  return true;
+}
@@ -0,0 +1,56 @@
+// Snake board renderer
+// Remembers the colour last drawn in every cell so a step only redraws the cells that changed,
+// and can keep every colour's cell pre-rasterised so a redraw is one image instead of the
+// dozen or so address windows fillRoundRect() sends for the rounded corners
+#ifndef SNAKE_RENDER_H
+#define SNAKE_RENDER_H
+
+#include <stdint.h>
+#include <TFT_eSPI.h>
+
+#define SNAKE_CORNER_RADIUS 3 // less on cells too small for it
+#define SNAKE_MAX_TILES 64
+
+struct SnakeScreen {
+  int xdim, ydim;
+  int cell;                    // pixels per side of a cell
+  uint16_t *drawn;             // colour last drawn in each cell, x major like grid[x][y]
+  unsigned long cellsDrawn;    // since snakeScreenBegin(), for reports
+};
+
+// A rounded cell in each colour the sketch draws with, ready to push. Corners are black, as the
+// board behind the cells always is.
+struct SnakeAtlas {
+  int cell;                    // pixels per side of a tile
+  int numTiles;
+  uint16_t colours[SNAKE_MAX_TILES];
+  uint16_t *pixels;            // numTiles tiles of cell*cell, panel byte order; NULL if none
+};
+
+// Allocates the shadow and assumes the board is black, as after tft.fillScreen(TFT_BLACK).
+// Returns false if the shadow cannot be allocated, snakeDrawCell() then draws every time.
+bool snakeScreenBegin(SnakeScreen &screen, int xdim, int ydim, int cell);
+void snakeScreenEnd(SnakeScreen &screen);
+
+// Forget what is on screen after something else has drawn over the board, every cell is
+// drawn again the next time it is given a colour
+void snakeScreenInvalidate(SnakeScreen &screen);
+
+// Cells drawn between snakeBatchStart() and snakeBatchFinish() share one SPI transaction
+// instead of opening and closing one per cell
+void snakeBatchStart(TFT_eSPI &tft);
+void snakeBatchFinish(TFT_eSPI &tft);
+
+// Draws cell (x, y) in colour unless that is already what it shows. Returns true if drawn.
+bool snakeDrawCell(TFT_eSPI &tft, SnakeScreen &screen, int x, int y, uint16_t colour);
+
+// Rasterises a tile for each of count colours, up to SNAKE_MAX_TILES, tile k being colours[k].
+// Returns false if the pixels cannot be allocated, snakeDrawTile() then falls back on
+// snakeDrawCell().
+bool snakeAtlasBegin(SnakeAtlas &atlas, int cell, const uint16_t *colours, int count);
+void snakeAtlasEnd(SnakeAtlas &atlas);
+
+// Same as snakeDrawCell() in the tile's colour, but pushes the tile in a single window
+bool snakeDrawTile(TFT_eSPI &tft, SnakeScreen &screen, const SnakeAtlas &atlas, int x, int y, int tile);
+
+#endif
@@ -0,0 +1,413 @@
+// Ripple engine host benchmark
+// Build from water_ripples/host:
+//   g++ -O2 -march=native -pthread -I.. ripple_bench.cpp ../ripple.cpp ../ripple_map.cpp -o ripple_bench
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "ripple.h"
+#include "ripple_field.h"
+#include "ripple_map.h"
+
+#define SELF_TEST_TRIALS 20000
+#define BENCH_STEPS 2000
+#define SCALING_STEPS 200
+
+static double nowSeconds() {
+  using namespace std::chrono;
+  return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void fillRandom(uint16_t *field, int cells, uint32_t seed) {
+  for (int k = 0; k < cells; k++) {
+    seed = seed * 1664525 + 1013904223;
+    field[k] = seed >> 16;
+  }
+}
+
+// Steps per second for one kernel at one grid size
+static double benchKernel(bool vector, int xdim, int ydim, int dampShift, RippleMode mode) {
+  uint16_t *p1 = (uint16_t *)malloc(xdim * ydim * sizeof(uint16_t));
+  uint16_t *p2 = (uint16_t *)malloc(xdim * ydim * sizeof(uint16_t));
+  fillRandom(p1, xdim*ydim, 1);
+  fillRandom(p2, xdim*ydim, 2);
+  double start = nowSeconds();
+  for (int t = 0; t < BENCH_STEPS; t++) {
+    if (vector) rippleStep(p1, p2, xdim, ydim, dampShift, mode);
+    else rippleStepScalar(p1, p2, xdim, ydim, dampShift, mode);
+    uint16_t *temp = p1;
+    p1 = p2;
+    p2 = temp;
+  }
+  double elapsed = nowSeconds() - start;
+  free(p1);
+  free(p2);
+  return BENCH_STEPS / elapsed;
+}
+
+// FNV-1a over the whole field, to compare runs bit for bit
+static uint32_t checksum(const uint16_t *field, int cells) {
+  uint32_t hash = 2166136261u;
+  for (int k = 0; k < cells; k++) {
+    hash = (hash ^ (field[k] & 0xff)) * 16777619u;
+    hash = (hash ^ (field[k] >> 8)) * 16777619u;
+  }
+  return hash;
+}
+
+// Runs SCALING_STEPS band-parallel steps with seeded raindrops injected after every barrier,
+// returns steps per second and the checksum of the final field
+static double benchParallel(int workers, int xdim, int ydim, int dampShift, uint32_t &sum) {
+  uint16_t *p1 = (uint16_t *)calloc(xdim * ydim, sizeof(uint16_t));
+  uint16_t *p2 = (uint16_t *)calloc(xdim * ydim, sizeof(uint16_t));
+  uint32_t seed = 7;
+  rippleParallelBegin(workers);
+  double start = nowSeconds();
+  for (int t = 0; t < SCALING_STEPS; t++) {
+    rippleParallelStep(p1, p2, p2, xdim, ydim, dampShift, RIPPLE_SATURATE);
+    seed = seed * 1664525 + 1013904223;
+    int col = 1 + (seed >> 8) % (xdim-2);
+    seed = seed * 1664525 + 1013904223;
+    int row = 1 + (seed >> 8) % (ydim-2);
+    p2[row*xdim + col] = 0xffff;
+    uint16_t *temp = p1;
+    p1 = p2;
+    p2 = temp;
+  }
+  double elapsed = nowSeconds() - start;
+  rippleParallelEnd();
+  sum = checksum(p1, xdim*ydim);
+  free(p1);
+  free(p2);
+  return SCALING_STEPS / elapsed;
+}
+
+// Large worlds: band-parallel against work-stealing tiles on grids far bigger than the screen,
+// alone and with a spinning thread competing for one of the cores. Checksums must match.
+#define LARGE_STEPS 40
+#define LARGE_TILE_X 256
+#define LARGE_TILE_Y 16
+static double benchLarge(bool tiles, bool contended, int workers, int xdim, int ydim, uint32_t &sum,
+                         double &steals) {
+  uint16_t *p1 = (uint16_t *)calloc((size_t)xdim * ydim, sizeof(uint16_t));
+  uint16_t *p2 = (uint16_t *)calloc((size_t)xdim * ydim, sizeof(uint16_t));
+  fillRandom(p1, xdim*ydim, 8);
+  fillRandom(p2, xdim*ydim, 9);
+  std::atomic<bool> spinning(contended);
+  std::thread spinner([&] { while (spinning) {} });
+  rippleParallelBegin(workers);
+  rippleResetStats();
+  double start = nowSeconds();
+  for (int t = 0; t < LARGE_STEPS; t++) {
+    if (tiles) rippleParallelStepTiles(p1, p2, p2, xdim, ydim, 9, RIPPLE_SATURATE, LARGE_TILE_X, LARGE_TILE_Y);
+    else rippleParallelStep(p1, p2, p2, xdim, ydim, 9, RIPPLE_SATURATE);
+    uint16_t *temp = p1;
+    p1 = p2;
+    p2 = temp;
+  }
+  double elapsed = nowSeconds() - start;
+  steals = (double)rippleStats.steals / LARGE_STEPS;
+  spinning = false;
+  spinner.join();
+  rippleParallelEnd();
+  sum = checksum(p1, xdim*ydim);
+  free(p1);
+  free(p2);
+  return LARGE_STEPS / elapsed;
+}
+
+static bool benchLargeWorld(int workers, int xdim, int ydim) {
+  double cells = (double)(xdim-2) * (ydim-2);
+  uint32_t reference = 0;
+  bool same = true;
+  for (int k = 0; k < 4; k++) {
+    bool tiles = k & 1, contended = k & 2;
+    uint32_t sum;
+    double steals;
+    double rate = benchLarge(tiles, contended, workers, xdim, ydim, sum, steals);
+    if (k == 0) reference = sum;
+    same = same && sum == reference;
+    char grid[16];
+    snprintf(grid, sizeof grid, "%dx%d", xdim, ydim);
+    printf("%-9s %-6s %-9s %12.1f %12.1f %08x\n", grid, tiles ? "steal" : "bands", contended ? "contended" : "idle",
+           rate * cells / 1e6, steals, sum);
+  }
+  return same;
+}
+
+// A single drop left to decay for IDLE_STEPS, stepped in full and with dirty tiles
+#define IDLE_STEPS 5000
+static bool benchIdle() {
+  const int xdim = 320, ydim = 170;
+  static uint16_t full[3][xdim * ydim], tiled[3][xdim * ydim];
+  static RippleActivity live[3];
+  memset(full, 0, sizeof full);
+  memset(tiled, 0, sizeof tiled);
+  for (int k = 0; k < 3; k++) rippleMarkAll(live[k]);
+  full[1][85*xdim + 160] = tiled[1][85*xdim + 160] = 0xffff;
+  double fullTime = 0, tiledTime = 0;
+  unsigned long cells = 0;
+  bool same = true;
+  for (int n = 2; n < IDLE_STEPS; n++) {
+    int s = (n+2) % 3, p = (n+1) % 3, d = n % 3;
+    double start = nowSeconds();
+    rippleStepFrom(full[s], full[p], full[d], xdim, ydim, 9, RIPPLE_SATURATE);
+    double middle = nowSeconds();
+    cells += rippleStepTiled(tiled[s], tiled[p], tiled[d], xdim, ydim, 9, RIPPLE_SATURATE, live[s], live[p], live[d]);
+    tiledTime += nowSeconds() - middle;
+    fullTime += middle - start;
+    same = same && memcmp(full[d], tiled[d], sizeof full[d]) == 0;
+  }
+  printf("idle drop: tiles computed %.1f%% of cells, %.2fx faster, identical: %s\n",
+         100.0 * cells / ((IDLE_STEPS-2) * (double)(xdim-2) * (ydim-2)), fullTime / tiledTime, same ? "yes" : "NO");
+  return same;
+}
+
+// Grids past the tile bitmap, too many tiles in all or too many across, with a drop in the
+// last tile: rippleStepTiled() has to fall back to the full step rather than lose it
+#define OVERSIZED_STEPS 20
+static bool benchOversized(int xdim, int ydim) {
+  size_t cells = (size_t)xdim * ydim;
+  uint16_t *full[3], *tiled[3];
+  static RippleActivity live[3];
+  for (int k = 0; k < 3; k++) {
+    full[k] = (uint16_t *)calloc(cells, sizeof(uint16_t));
+    tiled[k] = (uint16_t *)calloc(cells, sizeof(uint16_t));
+    rippleMarkAll(live[k]);
+  }
+  size_t drop = (size_t)(ydim-8)*xdim + xdim-8;
+  full[1][drop] = tiled[1][drop] = 0xffff;
+  bool same = true;
+  for (int n = 2; n < OVERSIZED_STEPS; n++) {
+    int s = (n+2) % 3, p = (n+1) % 3, d = n % 3;
+    rippleStepFrom(full[s], full[p], full[d], xdim, ydim, 9, RIPPLE_SATURATE);
+    rippleStepTiled(tiled[s], tiled[p], tiled[d], xdim, ydim, 9, RIPPLE_SATURATE, live[s], live[p], live[d]);
+    same = same && memcmp(full[d], tiled[d], cells * sizeof(uint16_t)) == 0;
+  }
+  printf("oversized %dx%d (%s the tile bitmap): identical: %s\n", xdim, ydim,
+         rippleTilesFit(xdim, ydim) ? "fits" : "past", same ? "yes" : "NO");
+  for (int k = 0; k < 3; k++) {
+    free(full[k]);
+    free(tiled[k]);
+  }
+  return same;
+}
+
+// Temporal blocking: steps per second for repeated rippleStep() against rippleStepBlocked()
+// at several block depths and strip widths, checking the fields match bit for bit. Below 1x
+// the blocked sweep is the slower one, as it is for any field that fits in cache.
+#define BLOCKED_STEPS 48
+static bool benchBlocked(int xdim, int ydim) {
+  int cells = xdim * ydim;
+  uint16_t *a = (uint16_t *)malloc(cells * sizeof(uint16_t));
+  uint16_t *b = (uint16_t *)malloc(cells * sizeof(uint16_t));
+  uint16_t *refA = (uint16_t *)malloc(cells * sizeof(uint16_t));
+  uint16_t *refB = (uint16_t *)malloc(cells * sizeof(uint16_t));
+  fillRandom(refA, cells, 3);
+  fillRandom(refB, cells, 4);
+  memcpy(a, refA, cells * sizeof(uint16_t));
+  memcpy(b, refB, cells * sizeof(uint16_t));
+
+  double start = nowSeconds();
+  for (int t = 0; t < BLOCKED_STEPS; t += 2) {
+    rippleStep(refA, refB, xdim, ydim, 9, RIPPLE_SATURATE);
+    rippleStep(refB, refA, xdim, ydim, 9, RIPPLE_SATURATE);
+  }
+  double naive = BLOCKED_STEPS / (nowSeconds() - start);
+  printf("%dx%d: one step per sweep %.1f Mcells/s\n", xdim, ydim, naive * (xdim-2) * (ydim-2) / 1e6);
+
+  const int strips[] = {32, 64, 128, 256, 512, 0};
+  bool same = true;
+  printf("  %-6s", "strip");
+  for (int steps = 2; steps <= 4; steps++) printf("   %d steps", steps);
+  printf("\n");
+  for (int k = 0; k < 6; k++) {
+    if (strips[k] >= xdim) continue;
+    char label[16];
+    snprintf(label, sizeof label, "%d", strips[k] ? strips[k] : xdim);
+    printf("  %-6s", label);
+    for (int steps = 2; steps <= 4; steps++) {
+      // 48 is a multiple of 2, 3 and 4, so every run ends on the same step as the reference
+      uint16_t *p1 = (uint16_t *)malloc(cells * sizeof(uint16_t));
+      uint16_t *p2 = (uint16_t *)malloc(cells * sizeof(uint16_t));
+      memcpy(p1, a, cells * sizeof(uint16_t));
+      memcpy(p2, b, cells * sizeof(uint16_t));
+      start = nowSeconds();
+      for (int t = 0; t < BLOCKED_STEPS; t += steps) {
+        rippleStepBlocked(p1, p2, xdim, ydim, 9, RIPPLE_SATURATE, steps, strips[k]);
+        if (steps & 1) {
+          uint16_t *temp = p1;
+          p1 = p2;
+          p2 = temp;
+        }
+      }
+      double rate = BLOCKED_STEPS / (nowSeconds() - start);
+      same = same && memcmp(p1, refA, cells * sizeof(uint16_t)) == 0 && memcmp(p2, refB, cells * sizeof(uint16_t)) == 0;
+      printf("  %7.2fx", rate / naive);
+      free(p1);
+      free(p2);
+    }
+    printf("\n");
+  }
+  free(a);
+  free(b);
+  free(refA);
+  free(refB);
+  return same;
+}
+
+// Coefficient maps: an open map with fixed edges must match rippleStepFrom() bit for bit, and
+// its cost over the plain kernel is the two extra planes read per cell
+static bool benchMapped(int xdim, int ydim) {
+  int cells = xdim * ydim;
+  uint16_t *plain[2], *mapped[2];
+  for (int k = 0; k < 2; k++) {
+    plain[k] = (uint16_t *)malloc(cells * sizeof(uint16_t));
+    mapped[k] = (uint16_t *)malloc(cells * sizeof(uint16_t));
+    fillRandom(plain[k], cells, 10 + k);
+    memcpy(mapped[k], plain[k], cells * sizeof(uint16_t));
+  }
+  RippleMap open;
+  rippleMapBegin(open, xdim, ydim, RIPPLE_EDGE_FIXED);
+  double start = nowSeconds();
+  for (int t = 0; t < BENCH_STEPS; t++) rippleStepFrom(plain[t & 1], plain[~t & 1], plain[~t & 1], xdim, ydim, 9, RIPPLE_SATURATE);
+  double middle = nowSeconds();
+  for (int t = 0; t < BENCH_STEPS; t++) {
+    rippleStepMapped(mapped[t & 1], mapped[~t & 1], mapped[~t & 1], xdim, ydim, 9, RIPPLE_SATURATE, open, RIPPLE_EDGE_FIXED);
+  }
+  double end = nowSeconds();
+  bool same = memcmp(plain[0], mapped[0], cells * sizeof(uint16_t)) == 0 &&
+              memcmp(plain[1], mapped[1], cells * sizeof(uint16_t)) == 0;
+  double interior = (double)(xdim-2) * (ydim-2);
+  printf("mapped %dx%d: plain %.1f Mcells/s, mapped %.1f Mcells/s (%.2fx the time), open map identical: %s\n", xdim, ydim,
+         BENCH_STEPS * interior / (middle - start) / 1e6, BENCH_STEPS * interior / (end - middle) / 1e6,
+         (end - middle) / (middle - start), same ? "yes" : "NO");
+  rippleMapEnd(open);
+  for (int k = 0; k < 2; k++) {
+    free(plain[k]);
+    free(mapped[k]);
+  }
+  return same;
+}
+
+// The loop each sketch carried before the engine, with its #defines as template parameters
+template <int XDIM, int YDIM, int DAMPENING>
+static void handWrittenStep(const uint16_t *source, uint16_t *dest) {
+  for (int i = 1; i < XDIM-1; i++) {
+    for (int j = 1; j < YDIM-1; j++) {
+      uint16_t smoothed =
+        (source[((j-1)*XDIM + i)]
+        + source[((j+1)*XDIM + i)]
+        + source[(j*XDIM + i-1)]
+        + source[(j*XDIM + i+1)]) >> 1;
+      if (smoothed > dest[j*XDIM + i]) dest[j*XDIM + i] = smoothed - dest[j*XDIM + i];
+      else dest[j*XDIM + i] = 0;
+      uint16_t dampening = dest[j*XDIM + i] >> DAMPENING;
+      if (dampening < dest[j*XDIM + i]) dest[j*XDIM + i] -= dampening;
+      else dest[j*XDIM + i] = 0;
+    }
+  }
+}
+
+// Steps per second for a preset: the original hand-written loop, the runtime-sized rippleStep()
+// and the preset's own step, all in wrap mode so the three must agree bit for bit
+template <typename Field>
+static bool benchPreset(const char *name) {
+  static uint16_t fields[3][2][Field::CELLS];
+  for (int k = 0; k < 3; k++) {
+    fillRandom(fields[k][0], Field::CELLS, 5);
+    fillRandom(fields[k][1], Field::CELLS, 6);
+  }
+  double rate[3];
+  for (int k = 0; k < 3; k++) {
+    uint16_t *p1 = fields[k][0], *p2 = fields[k][1];
+    double start = nowSeconds();
+    for (int t = 0; t < BENCH_STEPS; t++) {
+      if (k == 0) handWrittenStep<Field::XDIM, Field::YDIM, Field::DAMPENING>(p1, p2);
+      else if (k == 1) rippleStep(p1, p2, Field::XDIM, Field::YDIM, Field::DAMPENING);
+      else Field::template step<RIPPLE_WRAP>(p1, p2);
+      uint16_t *temp = p1;
+      p1 = p2;
+      p2 = temp;
+    }
+    rate[k] = BENCH_STEPS / (nowSeconds() - start);
+  }
+  bool same = true;
+  for (int k = 1; k < 3; k++) {
+    same = same && memcmp(fields[k], fields[0], sizeof fields[0]) == 0;
+  }
+  char grid[16];
+  snprintf(grid, sizeof grid, "%dx%d", Field::XDIM, Field::YDIM);
+  printf("%-14s %-9s %12.1f %12.1f %12.1f %7.2fx\n", name, grid, rate[0] * Field::INTERIOR / 1e6,
+         rate[1] * Field::INTERIOR / 1e6, rate[2] * Field::INTERIOR / 1e6, rate[2] / rate[0]);
+  return same;
+}
+
+int main() {
+  unsigned long mismatches = rippleSelfTest(12345, SELF_TEST_TRIALS);
+  printf("self test: %d trials, %lu mismatching cells\n", SELF_TEST_TRIALS, mismatches);
+
+  const int sizes[][3] = {{320, 170, 9}, {180, 95, 13}, {160, 85, 11}};
+  printf("%-9s %-9s %12s %12s %8s\n", "grid", "mode", "scalar Mc/s", "vector Mc/s", "speedup");
+  for (int s = 0; s < 3; s++) {
+    int xdim = sizes[s][0], ydim = sizes[s][1], dampShift = sizes[s][2];
+    double cells = (double)(xdim-2) * (ydim-2);
+    for (int m = 0; m < 2; m++) {
+      RippleMode mode = m ? RIPPLE_SATURATE : RIPPLE_WRAP;
+      double scalar = benchKernel(false, xdim, ydim, dampShift, mode);
+      double vector = benchKernel(true, xdim, ydim, dampShift, mode);
+      char grid[16];
+      snprintf(grid, sizeof grid, "%dx%d", xdim, ydim);
+      printf("%-9s %-9s %12.1f %12.1f %7.2fx\n", grid, m ? "saturate" : "wrap",
+             scalar * cells / 1e6, vector * cells / 1e6, vector / scalar);
+    }
+  }
+  printf("vector lanes: %d\n", RIPPLE_LANES);
+
+  printf("%-14s %-9s %12s %12s %12s %8s\n", "preset", "grid", "loop Mc/s", "runtime Mc/s", "preset Mc/s", "vs loop");
+  bool presetsSame = benchPreset<RippleClassic>("RippleClassic");
+  presetsSame = benchPreset<RippleFull>("RippleFull") && presetsSame;
+  presetsSame = benchPreset<RippleMini>("RippleMini") && presetsSame;
+  printf("presets identical to the hand-written loop: %s\n", presetsSame ? "yes" : "NO");
+  bool mappedSame = benchMapped(320, 170) && benchMapped(1024, 1024);
+
+  int maxWorkers = std::thread::hardware_concurrency();
+  if (maxWorkers < 2) maxWorkers = 2;
+  if (maxWorkers > RIPPLE_MAX_WORKERS) maxWorkers = RIPPLE_MAX_WORKERS;
+  const int scaling[][2] = {{320, 170}, {1024, 1024}};
+  bool deterministic = true;
+  printf("%-9s %7s %12s %8s %10s\n", "grid", "workers", "Mcells/s", "scaling", "checksum");
+  for (int s = 0; s < 2; s++) {
+    int xdim = scaling[s][0], ydim = scaling[s][1];
+    double cells = (double)(xdim-2) * (ydim-2);
+    double single = 0;
+    uint32_t reference = 0;
+    for (int workers = 1; workers <= maxWorkers; workers++) {
+      uint32_t sum;
+      double rate = benchParallel(workers, xdim, ydim, 9, sum);
+      if (workers == 1) {
+        single = rate;
+        reference = sum;
+      } else if (sum != reference) {
+        deterministic = false;
+      }
+      char grid[16];
+      snprintf(grid, sizeof grid, "%dx%d", xdim, ydim);
+      printf("%-9s %7d %12.1f %7.2fx %08x\n", grid, workers, rate * cells / 1e6, rate / single, sum);
+    }
+  }
+  printf("results identical across worker counts: %s\n", deterministic ? "yes" : "NO");
+  bool tilesSame = benchIdle();
+  tilesSame = benchOversized(2064, 1040) && tilesSame;
+  tilesSame = benchOversized(16400, 40) && tilesSame;
+
+  printf("%-9s %-6s %-9s %12s %12s %8s\n", "world", "split", "load", "Mcells/s", "steals/step", "checksum");
+  bool largeSame = benchLargeWorld(maxWorkers, 2048, 2048) && benchLargeWorld(maxWorkers, 4096, 4096);
+  printf("stolen tiles identical to bands: %s\n", largeSame ? "yes" : "NO");
+
+  bool blockedSame = benchBlocked(320, 170) && benchBlocked(2048, 2048);
+  printf("blocked results identical to repeated steps: %s\n", blockedSame ? "yes" : "NO");
+  return (mismatches == 0 && presetsSame && mappedSame && deterministic && tilesSame && largeSame && blockedSame) ? 0 : 1;
+}
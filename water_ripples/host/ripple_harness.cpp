@@ -0,0 +1,104 @@
+// Headless ripple harness
+// Links one of the water ripple sketches against the stubs in host/stub and runs it with no
+// board attached: a fixed seed, a virtual clock that steps one frame per loop(), and the
+// panel replaced by an in-memory framebuffer. Build from water_ripples/host, naming the
+// sketch and the RippleField preset it uses:
+//   g++ -O2 -march=native -pthread -Istub -I.. -DSKETCH_FIELD=RippleClassic ripple_harness.cpp ../main.cpp ../ripple.cpp ../ripple_render.cpp ../ripple_capture.cpp stub/stub.cpp -o ripple_harness
+// (main.cpp needs ../ripple_capture.cpp; ripple_v2.cpp: RippleClassic, ripple_v3.cpp: RippleFull, ripple_v3_mini.cpp: RippleMini; the v3
+// sketches also need ../ripple_governor.cpp; ripple_harbour.cpp: RippleClassic with ../ripple_map.cpp). ripple_ocean.cpp keeps its fields on the heap and
+// is not run here, ripple_bench measures its work-stealing step on large worlds instead.
+// Usage: ripple_harness [frames] [seed] [overlap|lockstep] [capture file]
+// Pipelined sketches are held in lock step with loop() so the checksums are reproducible,
+// pass overlap to let the simulation task run ahead as it does on the board. Anything the
+// sketch sends with Serial.write() (CAPTURE on) goes to the capture file, for ripple_viewer.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "host_stub.h"
+#include "ripple.h"
+#include "ripple_field.h"
+
+#ifndef SKETCH_FIELD
+#define SKETCH_FIELD RippleClassic
+#endif
+typedef SKETCH_FIELD Field;
+
+// Every sketch uses the same buttons and waits at most this long between frames
+#define LEFT 0
+#define RIGHT 14
+#define FRAME_MILLIS 101
+#define DEFAULT_FRAMES 1000
+
+// From the sketch. Only ripple_v3.cpp has a third frame.
+void setup();
+void loop();
+extern TFT_eSPI tft;
+extern uint16_t buffer1[], buffer2[];
+extern uint16_t *frames[3] __attribute__((weak));
+
+static double nowSeconds() {
+  using namespace std::chrono;
+  return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+// FNV-1a, the same hash as ripple_bench
+static uint32_t checksum(uint32_t hash, const uint16_t *field, int cells) {
+  for (int k = 0; k < cells; k++) {
+    hash = (hash ^ (field[k] & 0xff)) * 16777619u;
+    hash = (hash ^ (field[k] >> 8)) * 16777619u;
+  }
+  return hash;
+}
+
+int main(int argc, char **argv) {
+  int numFrames = argc > 1 ? atoi(argv[1]) : DEFAULT_FRAMES;
+  unsigned long seed = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+  bool overlap = argc > 3 && strcmp(argv[3], "overlap") == 0;
+  FILE *capture = argc > 4 ? fopen(argv[4], "wb") : NULL;
+  stubSerialCapture(capture);
+
+  randomSeed(seed);
+  setup();
+  stubQuiesce();
+  // The first loop() only starts the sketch's timers
+  loop();
+
+  // Click LEFT then RIGHT, which turns on the moving source and the pulse or rain in every sketch
+  unsigned long pixelsBefore = tft.pixelsWritten();
+  double start = nowSeconds();
+  for (int f = 0; f < numFrames; f++) {
+    // Quiesce before touching the clock, a task still finishing a frame may be reading it
+    if (!overlap) stubQuiesce();
+    stubSetPin(LEFT, f == 0 ? LOW : HIGH);
+    stubSetPin(RIGHT, f == 2 ? LOW : HIGH);
+    stubAdvanceMillis(FRAME_MILLIS);
+    loop();
+  }
+  double elapsed = nowSeconds() - start;
+  stubQuiesce();
+  // Band workers must be joined before their mutex and condition variables are destroyed
+  rippleParallelEnd();
+
+  stubSerialCapture(NULL);
+  if (capture) fclose(capture);
+
+  uint32_t heights = 2166136261u;
+  if (frames) {
+    for (int k = 0; k < 3; k++) heights = checksum(heights, frames[k], Field::CELLS);
+  } else {
+    heights = checksum(heights, buffer1, Field::CELLS);
+    heights = checksum(heights, buffer2, Field::CELLS);
+  }
+  uint32_t screen = checksum(2166136261u, tft.framebuffer(), tft.width() * tft.height());
+
+  printf("grid %dx%d, %d frames, seed %lu%s\n", Field::XDIM, Field::YDIM, numFrames, seed,
+         overlap ? ", overlapped" : "");
+  printf("%.2f ns/cell per frame, %.1f frames/s, %.0f pixels pushed per frame\n",
+         elapsed * 1e9 / ((double)numFrames * Field::INTERIOR), numFrames / elapsed,
+         (double)(tft.pixelsWritten() - pixelsBefore) / numFrames);
+  printf("height checksum %08x, screen checksum %08x\n", heights, screen);
+  return 0;
+}
@@ -0,0 +1,259 @@
+// Ripple capture viewer
+// Decodes the stream a sketch sends with CAPTURE on (see ripple_capture.h) and writes it out
+// as an animated GIF, each cell drawn scale x scale pixels as on the panel. The palette
+// indices go straight into the GIF, whose colour tables hold the same 256 entries.
+// Build from water_ripples/host:
+//   g++ -O2 -Istub -I.. ripple_viewer.cpp -o ripple_viewer
+// Usage: ripple_viewer capture.bin out.gif [max frames]
+// Record from the board with the port in raw mode, e.g.
+//   stty -F /dev/ttyACM0 raw && cat /dev/ttyACM0 > capture.bin
+// and convert to video with ffmpeg -i out.gif out.mp4 if needed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "ripple_capture.h"
+
+#define GIF_MAX_CODES 4096
+
+struct Stream {
+  std::vector<uint8_t> data;
+  size_t pos;
+  unsigned long badPackets;
+};
+
+// Next packet with a valid checksum, skipping anything else. False at the end of the data.
+static bool nextPacket(Stream &stream, char &type, const uint8_t *&payload, int &length) {
+  const std::vector<uint8_t> &d = stream.data;
+  while (stream.pos + 7 <= d.size()) {
+    size_t p = stream.pos;
+    if (d[p] != 0xa5 || d[p+1] != 0x5a) {
+      stream.pos++;
+      continue;
+    }
+    int n = d[p+3] | d[p+4] << 8;
+    if (n > RIPPLE_CAPTURE_MAX_PACKET || p + n + 7 > d.size()) {
+      stream.pos++;
+      continue;
+    }
+    uint16_t a = 0, b = 0;
+    for (size_t k = p + 2; k < p + n + 5; k++) {
+      a = (a + d[k]) % 255;
+      b = (b + a) % 255;
+    }
+    if (d[p+n+5] != a || d[p+n+6] != b) {
+      stream.badPackets++;
+      stream.pos++;
+      continue;
+    }
+    type = d[p+2];
+    payload = &d[p+5];
+    length = n;
+    stream.pos = p + n + 7;
+    return true;
+  }
+  return false;
+}
+
+// Variable-length codes packed least significant bit first into 255-byte sub-blocks
+struct GifBits {
+  FILE *out;
+  uint32_t bits;
+  int count;
+  uint8_t block[255];
+  int blockLength;
+};
+
+static void gifFlushBlock(GifBits &g) {
+  if (g.blockLength == 0) return;
+  fputc(g.blockLength, g.out);
+  fwrite(g.block, 1, g.blockLength, g.out);
+  g.blockLength = 0;
+}
+
+static void gifPutCode(GifBits &g, int code, int size) {
+  g.bits |= (uint32_t)code << g.count;
+  g.count += size;
+  while (g.count >= 8) {
+    g.block[g.blockLength++] = g.bits & 0xff;
+    if (g.blockLength == 255) gifFlushBlock(g);
+    g.bits >>= 8;
+    g.count -= 8;
+  }
+}
+
+// LZW with 8-bit symbols: clear is 256, end is 257, codes grow from 9 to 12 bits and the
+// table starts again when full. next[code][symbol] is the code for that string plus symbol.
+static void gifImage(FILE *out, const uint8_t *pixels, int count) {
+  static uint16_t next[GIF_MAX_CODES][256];
+  const int clear = 256, end = 257;
+  GifBits g = {out, 0, 0, {0}, 0};
+  fputc(8, out);
+  int size = 9, free = end + 1;
+  memset(next, 0, sizeof next);
+  gifPutCode(g, clear, size);
+  int prefix = pixels[0];
+  for (int k = 1; k < count; k++) {
+    uint8_t symbol = pixels[k];
+    if (next[prefix][symbol]) {
+      prefix = next[prefix][symbol];
+      continue;
+    }
+    gifPutCode(g, prefix, size);
+    if (free < GIF_MAX_CODES) {
+      next[prefix][symbol] = free;
+      // The decoder widens its codes once the table passes the current size
+      if (free++ == (1 << size) && size < 12) size++;
+    } else {
+      gifPutCode(g, clear, size);
+      memset(next, 0, sizeof next);
+      size = 9;
+      free = end + 1;
+    }
+    prefix = symbol;
+  }
+  gifPutCode(g, prefix, size);
+  gifPutCode(g, end, size);
+  if (g.count > 0) gifPutCode(g, 0, 8 - g.count);
+  gifFlushBlock(g);
+  fputc(0, out);
+}
+
+static void put16(FILE *out, int value) {
+  fputc(value & 0xff, out);
+  fputc(value >> 8, out);
+}
+
+// One full-screen frame shown for delay hundredths of a second
+static void gifFrame(FILE *out, const uint8_t *pixels, int width, int height, int delay) {
+  fwrite("\x21\xf9\x04\x04", 1, 4, out); // graphic control: leave the frame in place
+  put16(out, delay);
+  fputc(0, out);
+  fputc(0, out);
+  fputc(0x2c, out);
+  put16(out, 0);
+  put16(out, 0);
+  put16(out, width);
+  put16(out, height);
+  fputc(0, out);
+  gifImage(out, pixels, width * height);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: ripple_viewer capture.bin out.gif [max frames]\n");
+    return 1;
+  }
+  long maxFrames = argc > 3 ? atol(argv[3]) : -1;
+  FILE *in = fopen(argv[1], "rb");
+  if (!in) {
+    perror(argv[1]);
+    return 1;
+  }
+  Stream stream = {std::vector<uint8_t>(), 0, 0};
+  uint8_t chunk[4096];
+  size_t got;
+  while ((got = fread(chunk, 1, sizeof chunk, in)) > 0) stream.data.insert(stream.data.end(), chunk, chunk + got);
+  fclose(in);
+
+  FILE *out = NULL;
+  int xdim = 0, ydim = 0, scale = 1;
+  uint8_t colours[RIPPLE_LUT_SIZE * 3];
+  std::vector<uint8_t> cells, pixels;
+  bool started = false, inFrame = false;
+  unsigned long lastMillis = 0, frameMillis = 0;
+  long written = 0, rows = 0, residue = 0;
+  int delay = 5;
+  char type;
+  const uint8_t *p;
+  int length;
+  while (nextPacket(stream, type, p, length) && (maxFrames < 0 || written < maxFrames)) {
+    if (type == 'H' && length == 6 + 2*RIPPLE_LUT_SIZE && p[0] == RIPPLE_CAPTURE_VERSION) {
+      int x = p[1] | p[2] << 8, y = p[3] | p[4] << 8;
+      if (out && (x != xdim || y != ydim || p[5] != scale)) {
+        fprintf(stderr, "frame size changed mid-capture, stopping\n");
+        break;
+      }
+      xdim = x;
+      ydim = y;
+      scale = p[5] ? p[5] : 1;
+      for (int k = 0; k < RIPPLE_LUT_SIZE; k++) {
+        uint16_t c = p[6 + 2*k] | p[7 + 2*k] << 8;
+        colours[3*k] = (c >> 11) * 255 / 31;
+        colours[3*k+1] = ((c >> 5) & 63) * 255 / 63;
+        colours[3*k+2] = (c & 31) * 255 / 31;
+      }
+      cells.assign(xdim * ydim, 0);
+      pixels.resize((size_t)xdim * scale * ydim * scale);
+    } else if (type == 'F' && length == 9 && xdim > 0) {
+      bool key = p[8];
+      frameMillis = p[4] | p[5] << 8 | p[6] << 16 | (unsigned long)p[7] << 24;
+      // Deltas only make sense once a key frame has set every cell
+      if (key) {
+        started = true;
+        memset(cells.data(), 0, cells.size());
+      }
+      inFrame = started;
+    } else if (type == 'R' && length >= 2 && inFrame) {
+      int row = p[0] | p[1] << 8;
+      if (row >= ydim) continue;
+      uint8_t *cell = &cells[row * xdim];
+      int i = 0;
+      for (int k = 2; k + 1 < length;) {
+        int skip = p[k], n = p[k+1];
+        k += 2;
+        i += skip;
+        for (; n > 0 && k < length; n--, k++) {
+          if (i < xdim) cell[i] = p[k];
+          i++;
+        }
+      }
+      rows++;
+    } else if (type == 'E' && inFrame) {
+      int width = xdim * scale;
+      if (!out) {
+        out = fopen(argv[2], "wb");
+        if (!out) {
+          perror(argv[2]);
+          return 1;
+        }
+        fwrite("GIF89a", 1, 6, out);
+        put16(out, xdim * scale);
+        put16(out, ydim * scale);
+        fputc(0xf7, out); // global table of 256 colours
+        fputc(0, out);
+        fputc(0, out);
+        fwrite(colours, 1, sizeof colours, out);
+        // Loop forever
+        fwrite("\x21\xff\x0bNETSCAPE2.0\x03\x01\x00\x00\x00", 1, 19, out);
+      }
+      // A frame's delay is only known when the next one arrives, so each is written one late.
+      // Delays are in hundredths, carrying the remainder.
+      if (written > 0) {
+        unsigned long elapsed = frameMillis - lastMillis + residue;
+        delay = elapsed / 10;
+        residue = elapsed % 10;
+        gifFrame(out, pixels.data(), width, ydim * scale, delay);
+      }
+      lastMillis = frameMillis;
+      for (int y = 0; y < ydim * scale; y++) {
+        const uint8_t *cell = &cells[(y / scale) * xdim];
+        uint8_t *line = &pixels[(size_t)y * width];
+        for (int x = 0; x < width; x++) line[x] = cell[x / scale];
+      }
+      written++;
+      inFrame = false;
+    }
+  }
+  if (!out) {
+    fprintf(stderr, "no complete frames in %s\n", argv[1]);
+    return 1;
+  }
+  gifFrame(out, pixels.data(), xdim * scale, ydim * scale, delay);
+  fputc(0x3b, out);
+  fclose(out);
+  printf("%ld frames of %dx%d (scale %d), %zu bytes, %.0f bytes per frame, %.1f rows sent per frame, %lu bad packets\n",
+         written, xdim, ydim, scale, stream.data.size(), (double)stream.data.size() / written, (double)rows / written,
+         stream.badPackets);
+  return 0;
+}
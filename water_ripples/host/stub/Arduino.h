@@ -0,0 +1,58 @@
+// Host stand-in for the Arduino core
+// Just enough of the ESP32 Arduino API to build the sketches on Linux. millis() follows a
+// virtual clock the harness advances, micros() is the real clock so stage timings stay honest.
+#ifndef ARDUINO_STUB_H
+#define ARDUINO_STUB_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+using std::min;
+using std::max;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+// Same ranges as Arduino: [0, howBig) and [howSmall, howBig)
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+// Text is dropped unless the harness turns echo on, binary writes go to the capture file if set
+class HardwareSerial {
+public:
+  void begin(unsigned long baud) {}
+  void print(const char *text);
+  void print(char c);
+  void print(int value);
+  void print(unsigned int value);
+  void print(long value);
+  void print(unsigned long value);
+  void print(double value, int digits = 2);
+  void println();
+  size_t write(const uint8_t *data, size_t length);
+  template <typename T> void println(T value) {
+    print(value);
+    println();
+  }
+};
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,88 @@
+// Host stand-in for TFT_eSPI
+// Draws into an in-memory RGB565 framebuffer instead of the panel. Text is not rasterised,
+// only the calls the sketches make are provided. Shapes are broken into the same address
+// windows the library sends, so windowsOpened() counts what the panel would be asked for.
+#ifndef TFT_ESPI_STUB_H
+#define TFT_ESPI_STUB_H
+
+#include <stdint.h>
+
+#define TFT_BLACK 0x0000
+#define TFT_NAVY 0x000F
+#define TFT_DARKGREEN 0x03E0
+#define TFT_DARKCYAN 0x03EF
+#define TFT_MAROON 0x7800
+#define TFT_PURPLE 0x780F
+#define TFT_OLIVE 0x7BE0
+#define TFT_LIGHTGREY 0xD69A
+#define TFT_DARKGREY 0x7BEF
+#define TFT_BLUE 0x001F
+#define TFT_GREEN 0x07E0
+#define TFT_CYAN 0x07FF
+#define TFT_RED 0xF800
+#define TFT_MAGENTA 0xF81F
+#define TFT_YELLOW 0xFFE0
+#define TFT_WHITE 0xFFFF
+#define TFT_ORANGE 0xFDA0
+#define TFT_GREENYELLOW 0xB7E0
+#define TFT_PINK 0xFE19
+#define TFT_BROWN 0x9A60
+#define TFT_GOLD 0xFEA0
+#define TFT_SILVER 0xC618
+#define TFT_SKYBLUE 0x867D
+#define TFT_VIOLET 0x915C
+
+class TFT_eSPI {
+public:
+  TFT_eSPI(int16_t w = 170, int16_t h = 320);
+  ~TFT_eSPI();
+
+  void init();
+  void setRotation(uint8_t r);
+  int16_t width() { return _width; }
+  int16_t height() { return _height; }
+
+  void setSwapBytes(bool swap) { _swapBytes = swap; }
+  bool getSwapBytes() { return _swapBytes; }
+  void startWrite() {}
+  void endWrite() {}
+
+  void fillScreen(uint32_t colour);
+  void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t colour);
+  void fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t radius, uint32_t colour);
+  void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t colour);
+  void drawPixel(int32_t x, int32_t y, uint32_t colour);
+  void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data);
+
+  // DMA completes immediately, so the caller's buffer is free as soon as the call returns
+  bool initDMA(bool ctrlCS = false) { return true; }
+  void pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data, uint16_t *buffer = nullptr) {
+    pushImage(x, y, w, h, data);
+  }
+  bool dmaBusy() { return false; }
+  void dmaWait() {}
+
+  void setTextSize(uint8_t size) {}
+  void setTextColor(uint16_t colour) {}
+  void setTextColor(uint16_t colour, uint16_t background) {}
+  void setTextDatum(uint8_t datum) {}
+  void setCursor(int16_t x, int16_t y) {}
+  int16_t drawString(const char *text, int32_t x, int32_t y) { return 0; }
+
+  // Host-only: the panel contents in native RGB565, row major, width() pixels per row
+  const uint16_t *framebuffer() const { return _pixels; }
+  unsigned long pixelsWritten() const { return _written; }
+  unsigned long windowsOpened() const { return _windows; }
+
+private:
+  int16_t _nativeWidth, _nativeHeight;
+  int16_t _width, _height;
+  bool _swapBytes;
+  uint16_t *_pixels;
+  unsigned long _written;
+  unsigned long _windows;
+
+  void fillCircleHelper(int32_t x0, int32_t y0, int32_t r, uint8_t corners, int32_t delta, uint32_t colour);
+};
+
+#endif
@@ -0,0 +1,22 @@
+// Host stand-in for FreeRTOS
+// Tasks are std::threads and semaphores are a mutex and condition variable. Core affinity,
+// stack sizes and priorities are accepted and ignored.
+#ifndef FREERTOS_STUB_H
+#define FREERTOS_STUB_H
+
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void *);
+typedef struct StubTask *TaskHandle_t;
+typedef struct StubSemaphore *SemaphoreHandle_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffu
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#endif
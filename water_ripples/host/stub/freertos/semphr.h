@@ -0,0 +1,12 @@
+// Host stand-in for FreeRTOS semaphores
+#ifndef FREERTOS_SEMPHR_STUB_H
+#define FREERTOS_SEMPHR_STUB_H
+
+#include "FreeRTOS.h"
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount);
+SemaphoreHandle_t xSemaphoreCreateBinary();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+
+#endif
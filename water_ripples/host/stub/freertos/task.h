@@ -0,0 +1,11 @@
+// Host stand-in for FreeRTOS tasks
+#ifndef FREERTOS_TASK_STUB_H
+#define FREERTOS_TASK_STUB_H
+
+#include "FreeRTOS.h"
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stackDepth, void *params,
+                                   UBaseType_t priority, TaskHandle_t *created, BaseType_t core);
+void vTaskDelay(TickType_t ticks);
+
+#endif
@@ -0,0 +1,24 @@
+// Harness controls for the host stubs
+#ifndef HOST_STUB_H
+#define HOST_STUB_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Moves the millis() clock forward, nothing else happens until the sketch next runs
+void stubAdvanceMillis(unsigned long ms);
+
+// Level digitalRead() returns for a pin, HIGH by default as with the pullups
+void stubSetPin(uint8_t pin, int level);
+
+// Echo Serial output to stdout
+void stubSerialEcho(bool on);
+
+// Send whatever the sketch passes to Serial.write() to a file, NULL to drop it again
+void stubSerialCapture(FILE *file);
+
+// Blocks until every task created with xTaskCreatePinnedToCore() is waiting on a semaphore,
+// so work a task does next only depends on what the harness does next
+void stubQuiesce();
+
+#endif
@@ -0,0 +1,289 @@
+// Host stub implementations
+#include <stdio.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "host_stub.h"
+
+// Arduino core
+
+static unsigned long virtualMillis = 0;
+static uint32_t randomState = 1;
+static int pinLevels[64];
+static bool pinsSet = false;
+static bool serialEcho = false;
+static FILE *serialCapture = NULL;
+HardwareSerial Serial;
+
+unsigned long millis() {
+  return virtualMillis;
+}
+
+unsigned long micros() {
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void delay(unsigned long ms) {
+  virtualMillis += ms;
+}
+
+void stubAdvanceMillis(unsigned long ms) {
+  virtualMillis += ms;
+}
+
+// xorshift32, so a seed gives the same sequence on every host
+long random(long howBig) {
+  if (howBig <= 0) return 0;
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState % howBig;
+}
+
+long random(long howSmall, long howBig) {
+  if (howSmall >= howBig) return howSmall;
+  return howSmall + random(howBig - howSmall);
+}
+
+void randomSeed(unsigned long seed) {
+  randomState = seed ? seed : 1;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+int digitalRead(uint8_t pin) {
+  if (!pinsSet) return HIGH;
+  return pin < 64 ? pinLevels[pin] : HIGH;
+}
+
+int analogRead(uint8_t pin) {
+  return 2048;
+}
+
+void stubSetPin(uint8_t pin, int level) {
+  if (!pinsSet) {
+    for (int k = 0; k < 64; k++) pinLevels[k] = HIGH;
+    pinsSet = true;
+  }
+  if (pin < 64) pinLevels[pin] = level;
+}
+
+void stubSerialEcho(bool on) {
+  serialEcho = on;
+}
+
+void HardwareSerial::print(const char *text) {
+  if (serialEcho) fputs(text, stdout);
+}
+
+void HardwareSerial::print(char c) {
+  if (serialEcho) putchar(c);
+}
+
+void HardwareSerial::print(int value) {
+  if (serialEcho) printf("%d", value);
+}
+
+void HardwareSerial::print(unsigned int value) {
+  if (serialEcho) printf("%u", value);
+}
+
+void HardwareSerial::print(long value) {
+  if (serialEcho) printf("%ld", value);
+}
+
+void HardwareSerial::print(unsigned long value) {
+  if (serialEcho) printf("%lu", value);
+}
+
+void HardwareSerial::print(double value, int digits) {
+  if (serialEcho) printf("%.*f", digits, value);
+}
+
+void HardwareSerial::println() {
+  if (serialEcho) putchar('\n');
+}
+
+void stubSerialCapture(FILE *file) {
+  serialCapture = file;
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t length) {
+  if (serialCapture) fwrite(data, 1, length, serialCapture);
+  return length;
+}
+
+// FreeRTOS. Everything here is allocated once and never freed: tasks run forever and may
+// still be blocked on a semaphore when the harness exits.
+
+struct StubSemaphore {
+  UBaseType_t count, maxCount;
+  std::condition_variable changed;
+};
+
+// A task is idle while it waits on a semaphore that has nothing to give. Its state stays
+// pointed at the semaphore until it wakes, so a give makes it busy straight away.
+struct StubTask {
+  StubSemaphore *waitingOn;
+};
+
+static std::mutex &rtosLock = *new std::mutex;
+static std::condition_variable &rtosIdle = *new std::condition_variable;
+static std::vector<StubTask *> &tasks = *new std::vector<StubTask *>;
+static thread_local StubTask *currentTask = nullptr;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stackDepth, void *params,
+                                   UBaseType_t priority, TaskHandle_t *created, BaseType_t core) {
+  StubTask *task = new StubTask;
+  task->waitingOn = nullptr;
+  {
+    std::lock_guard<std::mutex> hold(rtosLock);
+    tasks.push_back(task);
+  }
+  std::thread([code, params, task]() {
+    currentTask = task;
+    code(params);
+  }).detach();
+  if (created) *created = task;
+  return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+  StubSemaphore *semaphore = new StubSemaphore;
+  semaphore->count = initialCount;
+  semaphore->maxCount = maxCount;
+  return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+  return xSemaphoreCreateCounting(1, 0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+  std::unique_lock<std::mutex> hold(rtosLock);
+  if (semaphore->count == 0 && ticks == 0) return pdFALSE;
+  if (semaphore->count == 0) {
+    if (currentTask) {
+      currentTask->waitingOn = semaphore;
+      rtosIdle.notify_all();
+    }
+    auto ready = [semaphore]() { return semaphore->count > 0; };
+    bool taken = true;
+    if (ticks == portMAX_DELAY) semaphore->changed.wait(hold, ready);
+    else taken = semaphore->changed.wait_for(hold, std::chrono::milliseconds(ticks), ready);
+    if (currentTask) currentTask->waitingOn = nullptr;
+    if (!taken) return pdFALSE;
+  }
+  semaphore->count--;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  std::lock_guard<std::mutex> hold(rtosLock);
+  if (semaphore->count >= semaphore->maxCount) return pdFALSE;
+  semaphore->count++;
+  semaphore->changed.notify_all();
+  return pdTRUE;
+}
+
+void stubQuiesce() {
+  std::unique_lock<std::mutex> hold(rtosLock);
+  rtosIdle.wait(hold, []() {
+    for (StubTask *task : tasks) {
+      if (!task->waitingOn || task->waitingOn->count > 0) return false;
+    }
+    return true;
+  });
+}
+
+// TFT_eSPI
+
+TFT_eSPI::TFT_eSPI(int16_t w, int16_t h)
+  : _nativeWidth(w), _nativeHeight(h), _width(w), _height(h), _swapBytes(false), _written(0), _windows(0) {
+  _pixels = new uint16_t[w * h]();
+}
+
+TFT_eSPI::~TFT_eSPI() {
+  delete[] _pixels;
+}
+
+void TFT_eSPI::init() {
+  fillScreen(TFT_BLACK);
+  _written = _windows = 0;
+}
+
+void TFT_eSPI::setRotation(uint8_t r) {
+  bool landscape = r & 1;
+  _width = landscape ? _nativeHeight : _nativeWidth;
+  _height = landscape ? _nativeWidth : _nativeHeight;
+}
+
+void TFT_eSPI::fillScreen(uint32_t colour) {
+  fillRect(0, 0, _width, _height, colour);
+}
+
+void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t colour) {
+  if (w > 0 && h > 0) _windows++;
+  for (int32_t j = max(y, 0); j < min(y + h, (int32_t)_height); j++) {
+    for (int32_t i = max(x, 0); i < min(x + w, (int32_t)_width); i++) {
+      _pixels[j*_width + i] = colour;
+      _written++;
+    }
+  }
+}
+
+// The library's own rounding: the middle band, then each pair of corners as one line per row
+void TFT_eSPI::fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t radius, uint32_t colour) {
+  fillRect(x, y + radius, w, h - radius - radius, colour);
+  fillCircleHelper(x + radius, y + h - radius - 1, radius, 1, w - radius - radius - 1, colour);
+  fillCircleHelper(x + radius, y + radius, radius, 2, w - radius - radius - 1, colour);
+}
+
+void TFT_eSPI::fillCircleHelper(int32_t x0, int32_t y0, int32_t r, uint8_t corners, int32_t delta, uint32_t colour) {
+  int32_t f = 1 - r, ddFx = 1, ddFy = -r - r, y = 0;
+  delta++;
+  while (y < r) {
+    if (f >= 0) {
+      if (corners & 1) drawFastHLine(x0 - y, y0 + r, y + y + delta, colour);
+      if (corners & 2) drawFastHLine(x0 - y, y0 - r, y + y + delta, colour);
+      r--;
+      ddFy += 2;
+      f += ddFy;
+    }
+    y++;
+    ddFx += 2;
+    f += ddFx;
+    if (corners & 1) drawFastHLine(x0 - r, y0 + y, r + r + delta, colour);
+    if (corners & 2) drawFastHLine(x0 - r, y0 - y, r + r + delta, colour);
+  }
+}
+
+void TFT_eSPI::drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t colour) {
+  fillRect(x, y, w, 1, colour);
+}
+
+void TFT_eSPI::drawPixel(int32_t x, int32_t y, uint32_t colour) {
+  fillRect(x, y, 1, 1, colour);
+}
+
+// With swapping off the data is already in panel byte order (high byte first in memory),
+// which is how the ripple palettes store their colours
+void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data) {
+  if (w > 0 && h > 0) _windows++;
+  for (int32_t j = max(y, 0); j < min(y + h, (int32_t)_height); j++) {
+    for (int32_t i = max(x, 0); i < min(x + w, (int32_t)_width); i++) {
+      uint16_t colour = data[(j-y)*w + (i-x)];
+      _pixels[j*_width + i] = _swapBytes ? colour : (uint16_t)(colour << 8 | colour >> 8);
+      _written++;
+    }
+  }
+}
@@ -0,0 +1,573 @@
+// Ripple stencil engine
+#include "ripple.h"
+#include "ripple_kernel.h"
+#include <string.h>
+#include <atomic>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+unsigned long rippleMicros() {
+#ifdef ARDUINO
+  return micros();
+#else
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+const int RIPPLE_LANES = RIPPLE_VECTOR_LANES;
+
+RippleStats rippleStats = {0, 0, 0, 0};
+
+#if defined(RIPPLE_PIE)
+bool rippleUsePie = true;
+#endif
+
+unsigned long rippleStepRows(const uint16_t *source, const uint16_t *prev, uint16_t *dest, int xdim, int ydim,
+                             int dampShift, int rowBegin, int rowEnd, RippleMode mode) {
+  if (rowBegin < 1) rowBegin = 1;
+  if (rowEnd > ydim-1) rowEnd = ydim-1;
+  if (rowBegin >= rowEnd || xdim < 3) return 0;
+
+  // Sliding row pointers: each iteration shifts the three-row window down by one row
+  const uint16_t *up = source + (rowBegin-1)*xdim;
+  const uint16_t *mid = up + xdim;
+  const uint16_t *down = mid + xdim;
+  const uint16_t *back = prev + rowBegin*xdim;
+  uint16_t *out = dest + rowBegin*xdim;
+  for (int j = rowBegin; j < rowEnd; j++) {
+    int tail = rippleRowVector(up, mid, down, back, out, 1, xdim-1, dampShift, mode);
+    rippleRowScalar(up, mid, down, back, out, tail, xdim-1, dampShift, mode);
+    up = mid;
+    mid = down;
+    down += xdim;
+    back += xdim;
+    out += xdim;
+  }
+  return (unsigned long)(rowEnd - rowBegin) * (xdim - 2);
+}
+
+unsigned long rippleStep(const uint16_t *source, uint16_t *dest, int xdim, int ydim, int dampShift,
+                         RippleMode mode) {
+  return rippleStepFrom(source, dest, dest, xdim, ydim, dampShift, mode);
+}
+
+unsigned long rippleStepFrom(const uint16_t *source, const uint16_t *prev, uint16_t *dest, int xdim, int ydim,
+                             int dampShift, RippleMode mode) {
+  unsigned long start = rippleMicros();
+  unsigned long cells = rippleStepRows(source, prev, dest, xdim, ydim, dampShift, 1, ydim-1, mode);
+  rippleStats.cells += cells;
+  rippleStats.micros += rippleMicros() - start;
+  rippleStats.steps++;
+  return cells;
+}
+
+void rippleMarkAll(RippleActivity &live) {
+  memset(live.bits, 0xff, sizeof live.bits);
+}
+
+static bool rippleRowsZero(const uint16_t *row, int xdim, int first, int last, int rows) {
+  uint16_t any = 0;
+  for (int r = 0; r < rows; r++, row += xdim) {
+    for (int i = first; i < last; i++) any |= row[i];
+  }
+  return any == 0;
+}
+
+unsigned long rippleStepTiled(const uint16_t *source, const uint16_t *prev, uint16_t *dest, int xdim, int ydim,
+                              int dampShift, RippleMode mode, const RippleActivity &sourceLive,
+                              const RippleActivity &prevLive, RippleActivity &destLive) {
+  if (!rippleTilesFit(xdim, ydim)) {
+    rippleMarkAll(destLive);
+    return rippleStepFrom(source, prev, dest, xdim, ydim, dampShift, mode);
+  }
+  unsigned long start = rippleMicros();
+  unsigned long cells = 0;
+  int tilesX = (xdim + RIPPLE_TILE-1) / RIPPLE_TILE;
+  int tilesY = (ydim + RIPPLE_TILE-1) / RIPPLE_TILE;
+  bool live[RIPPLE_MAX_TILE_COLUMNS];
+  for (int ty = 0; ty < tilesY; ty++) {
+    int y0 = ty*RIPPLE_TILE, y1 = y0 + RIPPLE_TILE;
+    if (y0 < 1) y0 = 1;
+    if (y1 > ydim-1) y1 = ydim-1;
+    // A tile can only become non-zero if it was non-zero one step back, or any cell its
+    // stencil reads (in this tile or a neighbour) is non-zero in source
+    for (int tx = 0; tx < tilesX; tx++) {
+      int tile = ty*tilesX + tx;
+      live[tx] = rippleTileLive(prevLive, tile);
+      for (int ny = ty-1; ny <= ty+1 && !live[tx]; ny++) {
+        for (int nx = tx-1; nx <= tx+1 && !live[tx]; nx++) {
+          if (nx >= 0 && ny >= 0 && nx < tilesX && ny < tilesY) live[tx] = rippleTileLive(sourceLive, ny*tilesX + nx);
+        }
+      }
+    }
+    int tx = 0;
+    while (tx < tilesX) {
+      // Consecutive tiles in the same state are handled as one run, so live runs keep the
+      // vector kernel busy across tile boundaries
+      int runEnd = tx + 1;
+      while (runEnd < tilesX && live[runEnd] == live[tx]) runEnd++;
+      int x0 = tx*RIPPLE_TILE, x1 = runEnd*RIPPLE_TILE;
+      if (x0 < 1) x0 = 1;
+      if (x1 > xdim-1) x1 = xdim-1;
+      if (x0 < x1 && y0 < y1 && live[tx]) {
+        const uint16_t *up = source + (y0-1)*xdim;
+        const uint16_t *back = prev + y0*xdim;
+        uint16_t *out = dest + y0*xdim;
+        for (int j = y0; j < y1; j++) {
+          int tail = rippleRowVector(up, up + xdim, up + 2*xdim, back, out, x0, x1, dampShift, mode);
+          rippleRowScalar(up, up + xdim, up + 2*xdim, back, out, tail, x1, dampShift, mode);
+          up += xdim;
+          back += xdim;
+          out += xdim;
+        }
+        cells += (unsigned long)(x1-x0) * (y1-y0);
+        for (int t = tx; t < runEnd; t++) {
+          int first = t*RIPPLE_TILE, last = first + RIPPLE_TILE;
+          if (first < x0) first = x0;
+          if (last > x1) last = x1;
+          rippleSetTile(destLive, ty*tilesX + t, !rippleRowsZero(dest + y0*xdim, xdim, first, last, y1-y0));
+        }
+      } else {
+        for (int t = tx; t < runEnd; t++) {
+          int tile = ty*tilesX + t;
+          // The new step is all zero here; dest only needs clearing if it still holds an older frame
+          if (dest != prev && rippleTileLive(destLive, tile) && y0 < y1) {
+            int first = t*RIPPLE_TILE, last = first + RIPPLE_TILE;
+            if (first < 1) first = 1;
+            if (last > xdim-1) last = xdim-1;
+            for (int j = y0; j < y1 && first < last; j++) memset(dest + j*xdim + first, 0, (last-first) * sizeof(uint16_t));
+          }
+          rippleSetTile(destLive, tile, false);
+        }
+      }
+      tx = runEnd;
+    }
+  }
+  rippleStats.cells += cells;
+  rippleStats.micros += rippleMicros() - start;
+  rippleStats.steps++;
+  return cells;
+}
+
+unsigned long rippleStepBlocked(uint16_t *a, uint16_t *b, int xdim, int ydim, int dampShift, RippleMode mode,
+                                int steps, int stripWidth) {
+  if (xdim < 3 || ydim < 3 || steps < 1) return 0;
+  if (stripWidth < 1) stripWidth = xdim;
+  unsigned long start = rippleMicros();
+  // Step s covers the strip's columns shifted left by s-1 and row r is reached at sweep
+  // position r+s-1. Everything step s reads from step s-1 is then already computed, and
+  // the step s-2 values it overwrites are no longer needed by step s-1.
+  for (int x0 = 1; x0 - (steps-1) < xdim-1; x0 += stripWidth) {
+    for (int k = 1; k < ydim-1 + steps-1; k++) {
+      for (int s = 1; s <= steps; s++) {
+        int r = k - (s-1);
+        if (r < 1 || r > ydim-2) continue;
+        int first = x0 - (s-1), last = x0 + stripWidth - (s-1);
+        if (first < 1) first = 1;
+        if (last > xdim-1) last = xdim-1;
+        if (first >= last) continue;
+        const uint16_t *source = (s & 1) ? a : b;
+        uint16_t *dest = (s & 1) ? b : a;
+        const uint16_t *up = source + (r-1)*xdim;
+        uint16_t *out = dest + r*xdim;
+        int tail = rippleRowVector(up, up + xdim, up + 2*xdim, out, out, first, last, dampShift, mode);
+        rippleRowScalar(up, up + xdim, up + 2*xdim, out, out, tail, last, dampShift, mode);
+      }
+    }
+  }
+  unsigned long cells = (unsigned long)steps * (xdim-2) * (ydim-2);
+  rippleStats.cells += cells;
+  rippleStats.micros += rippleMicros() - start;
+  rippleStats.steps += steps;
+  return cells;
+}
+
+void rippleSplash(uint16_t *field, int xdim, int ydim, uint32_t &seed) {
+  uint32_t state = seed ? seed : 1;
+  for (int j = 1; j < ydim-1; j++) {
+    uint16_t *row = field + j*xdim;
+    for (int i = 1; i < xdim-1; i++) {
+      if (row[i] > 0x2000 && row[i] < 0x5000) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        row[i] += ((state >> 16) * 0xa000) >> 16;
+      }
+    }
+  }
+  seed = state;
+}
+
+// Centre of cell k of a grid of n cells, in 1/256 cells of a grid of m cells over the same span
+static inline int rippleResamplePos(int k, int n, int m) {
+  int pos = (int)(((2*k + 1) * (long)m << 7) / n) - 128;
+  if (pos < 0) return 0;
+  if (pos > (m-1) << 8) return (m-1) << 8;
+  return pos;
+}
+
+void rippleResample(const uint16_t *source, int sourceX, int sourceY, uint16_t *dest, int destX, int destY) {
+  memset(dest, 0, destX * sizeof(uint16_t));
+  memset(dest + (destY-1)*destX, 0, destX * sizeof(uint16_t));
+  for (int j = 1; j < destY-1; j++) {
+    int y = rippleResamplePos(j, destY, sourceY);
+    uint32_t below = y & 0xff;
+    const uint16_t *top = source + (y >> 8)*sourceX;
+    const uint16_t *bottom = below ? top + sourceX : top;
+    uint16_t *out = dest + j*destX;
+    out[0] = out[destX-1] = 0;
+    for (int i = 1; i < destX-1; i++) {
+      int x = rippleResamplePos(i, destX, sourceX);
+      uint32_t right = x & 0xff;
+      int k = x >> 8, l = right ? k+1 : k;
+      uint32_t upper = top[k]*(256 - right) + top[l]*right;
+      uint32_t lower = bottom[k]*(256 - right) + bottom[l]*right;
+      out[i] = (upper*(256 - below) + lower*below) >> 16;
+    }
+  }
+}
+
+// The step every worker is currently running, written only while all workers are idle
+struct RippleJob {
+  const uint16_t *source;
+  const uint16_t *prev;
+  uint16_t *dest;
+  int xdim, ydim, dampShift;
+  RippleMode mode;
+  int tileX, tileY, tilesX; // tileX is 0 for one band per worker
+};
+static RippleJob rippleJob;
+static int rippleWorkers = 0;
+
+// Each worker's run of tiles still to do, packed as next | end << 16. The owner takes from
+// the front, thieves take from the back, both by compare and swap.
+static std::atomic<uint32_t> rippleRuns[RIPPLE_MAX_WORKERS];
+static std::atomic<unsigned long> rippleStolen(0);
+
+static inline uint32_t ripplePackRun(uint32_t next, uint32_t end) {
+  return next | end << 16;
+}
+
+static void rippleRunTile(int tile) {
+  const RippleJob &job = rippleJob;
+  int x0 = 1 + (tile % job.tilesX) * job.tileX, x1 = x0 + job.tileX;
+  int y0 = 1 + (tile / job.tilesX) * job.tileY, y1 = y0 + job.tileY;
+  if (x1 > job.xdim-1) x1 = job.xdim-1;
+  if (y1 > job.ydim-1) y1 = job.ydim-1;
+  const uint16_t *up = job.source + (y0-1)*job.xdim;
+  const uint16_t *back = job.prev + y0*job.xdim;
+  uint16_t *out = job.dest + y0*job.xdim;
+  for (int j = y0; j < y1; j++) {
+    int tail = rippleRowVector(up, up + job.xdim, up + 2*job.xdim, back, out, x0, x1, job.dampShift, job.mode);
+    rippleRowScalar(up, up + job.xdim, up + 2*job.xdim, back, out, tail, x1, job.dampShift, job.mode);
+    up += job.xdim;
+    back += job.xdim;
+    out += job.xdim;
+  }
+}
+
+// Works through its own run, then steals the back half of the first other run with anything
+// left, until every run is empty
+static void rippleRunTiles(int worker) {
+  std::atomic<uint32_t> &own = rippleRuns[worker];
+  for (;;) {
+    uint32_t run = own.load();
+    while ((run & 0xffff) < (run >> 16)) {
+      if (own.compare_exchange_weak(run, run + 1)) {
+        rippleRunTile(run & 0xffff);
+        run = own.load();
+      }
+    }
+    bool stole = false;
+    for (int k = 1; k < rippleWorkers && !stole; k++) {
+      std::atomic<uint32_t> &victim = rippleRuns[(worker + k) % rippleWorkers];
+      uint32_t theirs = victim.load();
+      while (!stole && (theirs & 0xffff) < (theirs >> 16)) {
+        uint32_t next = theirs & 0xffff, end = theirs >> 16;
+        uint32_t split = end - (end - next + 1) / 2;
+        if (victim.compare_exchange_weak(theirs, ripplePackRun(next, split))) {
+          own.store(ripplePackRun(split, end));
+          rippleStolen++;
+          stole = true;
+        }
+      }
+    }
+    if (!stole) return;
+  }
+}
+
+static void rippleRunBand(int band) {
+  if (rippleJob.tileX > 0) {
+    rippleRunTiles(band);
+    return;
+  }
+  int rows = rippleJob.ydim - 2;
+  int rowBegin = 1 + rows * band / rippleWorkers;
+  int rowEnd = 1 + rows * (band+1) / rippleWorkers;
+  rippleStepRows(rippleJob.source, rippleJob.prev, rippleJob.dest, rippleJob.xdim, rippleJob.ydim,
+                 rippleJob.dampShift, rowBegin, rowEnd, rippleJob.mode);
+}
+
+#if defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+#define RIPPLE_STACK_SIZE 4096
+#define RIPPLE_PRIORITY 2
+
+static TaskHandle_t rippleTasks[RIPPLE_MAX_WORKERS];
+static SemaphoreHandle_t rippleDone;
+
+// Sleeps until notified, runs its band, then checks in at the barrier
+static void rippleWorkerTask(void *arg) {
+  int band = (int)(intptr_t)arg;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    rippleRunBand(band);
+    xSemaphoreGive(rippleDone);
+  }
+}
+
+void rippleParallelBegin(int workers) {
+  rippleParallelEnd();
+  if (workers > RIPPLE_MAX_WORKERS) workers = RIPPLE_MAX_WORKERS;
+  if (workers < 2) return;
+  rippleDone = xSemaphoreCreateCounting(workers, 0);
+  for (int w = 0; w < workers; w++) {
+    xTaskCreatePinnedToCore(rippleWorkerTask, "ripple", RIPPLE_STACK_SIZE, (void *)(intptr_t)w,
+                            RIPPLE_PRIORITY, &rippleTasks[w], w % 2);
+  }
+  rippleWorkers = workers;
+}
+
+static void rippleRunWorkers() {
+  for (int w = 0; w < rippleWorkers; w++) xTaskNotifyGive(rippleTasks[w]);
+  for (int w = 0; w < rippleWorkers; w++) xSemaphoreTake(rippleDone, portMAX_DELAY);
+}
+
+void rippleParallelEnd() {
+  if (rippleWorkers == 0) return;
+  for (int w = 0; w < rippleWorkers; w++) vTaskDelete(rippleTasks[w]);
+  vSemaphoreDelete(rippleDone);
+  rippleWorkers = 0;
+}
+#else
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+static std::thread rippleThreads[RIPPLE_MAX_WORKERS];
+static std::mutex rippleMutex;
+static std::condition_variable rippleStart;
+static std::condition_variable rippleDone;
+static unsigned long rippleGeneration = 0;
+static int ripplePending = 0;
+static bool rippleStopping = false;
+
+// Waits for the next generation, runs its band, then checks in at the barrier. Starts from the
+// generation current when it was created, or it would rerun the last pool's final job.
+static void rippleWorkerThread(int band, unsigned long seen) {
+  std::unique_lock<std::mutex> lock(rippleMutex);
+  for (;;) {
+    rippleStart.wait(lock, [&] { return rippleStopping || rippleGeneration != seen; });
+    if (rippleStopping) return;
+    seen = rippleGeneration;
+    lock.unlock();
+    rippleRunBand(band);
+    lock.lock();
+    if (--ripplePending == 0) rippleDone.notify_one();
+  }
+}
+
+void rippleParallelBegin(int workers) {
+  rippleParallelEnd();
+  if (workers > RIPPLE_MAX_WORKERS) workers = RIPPLE_MAX_WORKERS;
+  if (workers < 2) return;
+  rippleWorkers = workers;
+  for (int w = 0; w < workers; w++) rippleThreads[w] = std::thread(rippleWorkerThread, w, rippleGeneration);
+}
+
+static void rippleRunWorkers() {
+  std::unique_lock<std::mutex> lock(rippleMutex);
+  ripplePending = rippleWorkers;
+  rippleGeneration++;
+  rippleStart.notify_all();
+  rippleDone.wait(lock, [] { return ripplePending == 0; });
+}
+
+void rippleParallelEnd() {
+  if (rippleWorkers == 0) return;
+  {
+    std::lock_guard<std::mutex> lock(rippleMutex);
+    rippleStopping = true;
+  }
+  rippleStart.notify_all();
+  for (int w = 0; w < rippleWorkers; w++) rippleThreads[w].join();
+  rippleStopping = false;
+  rippleWorkers = 0;
+}
+#endif
+
+unsigned long rippleParallelStep(const uint16_t *source, const uint16_t *prev, uint16_t *dest, int xdim, int ydim,
+                                 int dampShift, RippleMode mode) {
+  if (rippleWorkers < 2 || ydim - 2 < rippleWorkers) {
+    return rippleStepFrom(source, prev, dest, xdim, ydim, dampShift, mode);
+  }
+  unsigned long start = rippleMicros();
+  rippleJob.source = source;
+  rippleJob.prev = prev;
+  rippleJob.dest = dest;
+  rippleJob.xdim = xdim;
+  rippleJob.ydim = ydim;
+  rippleJob.dampShift = dampShift;
+  rippleJob.mode = mode;
+  rippleJob.tileX = 0;
+  rippleRunWorkers();
+  unsigned long cells = (unsigned long)(ydim-2) * (xdim-2);
+  rippleStats.cells += cells;
+  rippleStats.micros += rippleMicros() - start;
+  rippleStats.steps++;
+  return cells;
+}
+
+unsigned long rippleParallelStepTiles(const uint16_t *source, const uint16_t *prev, uint16_t *dest, int xdim,
+                                      int ydim, int dampShift, RippleMode mode, int tileX, int tileY) {
+  if (xdim < 3 || ydim < 3) return 0;
+  if (tileX < 1) tileX = 1;
+  if (tileY < 1) tileY = 1;
+  int tilesX = (xdim-2 + tileX-1) / tileX;
+  int tilesY = (ydim-2 + tileY-1) / tileY;
+  // Runs hold 16-bit tile numbers, taller tiles keep the count in range
+  while (tilesX * tilesY > RIPPLE_MAX_RUN_TILES) {
+    tileY *= 2;
+    tilesY = (ydim-2 + tileY-1) / tileY;
+  }
+  int tiles = tilesX * tilesY;
+  if (rippleWorkers < 2 || tiles < rippleWorkers) {
+    return rippleStepFrom(source, prev, dest, xdim, ydim, dampShift, mode);
+  }
+  unsigned long start = rippleMicros();
+  rippleJob.source = source;
+  rippleJob.prev = prev;
+  rippleJob.dest = dest;
+  rippleJob.xdim = xdim;
+  rippleJob.ydim = ydim;
+  rippleJob.dampShift = dampShift;
+  rippleJob.mode = mode;
+  rippleJob.tileX = tileX;
+  rippleJob.tileY = tileY;
+  rippleJob.tilesX = tilesX;
+  // Tiles are numbered row by row, so each worker starts on its own band as rippleParallelStep()
+  for (int w = 0; w < rippleWorkers; w++) {
+    rippleRuns[w].store(ripplePackRun(tiles * w / rippleWorkers, tiles * (w+1) / rippleWorkers));
+  }
+  rippleStolen = 0;
+  rippleRunWorkers();
+  unsigned long cells = (unsigned long)(ydim-2) * (xdim-2);
+  rippleStats.cells += cells;
+  rippleStats.micros += rippleMicros() - start;
+  rippleStats.steps++;
+  rippleStats.steals += rippleStolen;
+  return cells;
+}
+
+unsigned long rippleStepScalar(const uint16_t *source, uint16_t *dest, int xdim, int ydim, int dampShift,
+                               RippleMode mode) {
+  for (int j = 1; j < ydim-1; j++) {
+    rippleRowScalar(source + (j-1)*xdim, source + j*xdim, source + (j+1)*xdim, dest + j*xdim, dest + j*xdim,
+                    1, xdim-1, dampShift, mode);
+  }
+  return (ydim < 3 || xdim < 3) ? 0 : (unsigned long)(ydim-2) * (xdim-2);
+}
+
+// xorshift32, so the self test gives the same fields on every platform
+static uint32_t rippleNext(uint32_t &state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+unsigned long rippleSelfTest(uint32_t seed, int trials) {
+  const int MAX_X = 67, MAX_Y = 9;
+  static uint16_t source[MAX_X * MAX_Y];
+  static uint16_t vectorDest[MAX_X * MAX_Y];
+  static uint16_t scalarDest[MAX_X * MAX_Y];
+  static uint16_t prev[MAX_X * MAX_Y];
+  static uint16_t slow[MAX_X * MAX_Y];
+  static uint16_t loss[MAX_X * MAX_Y];
+  uint32_t state = seed ? seed : 1;
+  unsigned long mismatches = 0, plainMismatches = 0;
+
+  for (int t = 0; t < trials; t++) {
+    int xdim = 3 + rippleNext(state) % (MAX_X - 2);
+    int ydim = 3 + rippleNext(state) % (MAX_Y - 2);
+    int dampShift = 1 + rippleNext(state) % 15;
+    RippleMode mode = (t & 1) ? RIPPLE_SATURATE : RIPPLE_WRAP;
+    // Alternate between uniform noise and fields biased towards 0xffff, which exercise the overflow path
+    uint16_t bias = (t & 2) ? 0xc000 : 0;
+    // Every fourth pair of trials runs out of place, from a separate prev into a scratch dest
+    bool outOfPlace = t & 4;
+    // Every other group of eight runs the mapped kernels, with open water, walls and random
+    // coefficients mixed
+    bool mapped = t & 8;
+    for (int k = 0; k < xdim*ydim; k++) {
+      source[k] = rippleNext(state) | bias;
+      prev[k] = vectorDest[k] = scalarDest[k] = rippleNext(state);
+      if (outOfPlace) vectorDest[k] = ~prev[k];
+      uint32_t coefficients = rippleNext(state);
+      slow[k] = (coefficients & 3) ? coefficients >> 16 : 0;
+      loss[k] = (coefficients & 12) == 0 ? 0xffff : ((coefficients & 12) == 4 ? 0 : coefficients >> 8);
+    }
+    if (outOfPlace) {
+      // The outer ring is not written by the update
+      for (int k = 0; k < xdim*ydim; k++) {
+        int i = k % xdim, j = k / xdim;
+        if (i == 0 || j == 0 || i == xdim-1 || j == ydim-1) vectorDest[k] = prev[k];
+      }
+    }
+    if (mapped) {
+      for (int j = 1; j < ydim-1; j++) {
+        const uint16_t *mid = source + j*xdim;
+        const uint16_t *back = outOfPlace ? prev : vectorDest;
+        int tail = rippleRowMappedVector(mid - xdim, mid, mid + xdim, back + j*xdim, vectorDest + j*xdim,
+                                         slow + j*xdim, loss + j*xdim, 1, xdim-1, dampShift, mode);
+        rippleRowMappedScalar(mid - xdim, mid, mid + xdim, back + j*xdim, vectorDest + j*xdim, slow + j*xdim,
+                              loss + j*xdim, tail, xdim-1, dampShift, mode);
+        rippleRowMappedScalar(mid - xdim, mid, mid + xdim, scalarDest + j*xdim, scalarDest + j*xdim, slow + j*xdim,
+                              loss + j*xdim, 1, xdim-1, dampShift, mode);
+      }
+    } else {
+      rippleStepRows(source, outOfPlace ? prev : vectorDest, vectorDest, xdim, ydim, dampShift, 1, ydim-1, mode);
+      rippleStepScalar(source, scalarDest, xdim, ydim, dampShift, mode);
+    }
+    for (int k = 0; k < xdim*ydim; k++) {
+      if (vectorDest[k] == scalarDest[k]) continue;
+      mismatches++;
+      if (!mapped) plainMismatches++;
+    }
+  }
+#if defined(RIPPLE_PIE)
+  // The plain trials ran the PIE loop: if it got any cell wrong, go back to the generic kernel
+  if (plainMismatches > 0) rippleUsePie = false;
+#endif
+  return mismatches;
+}
+
+float rippleCellsPerSecond() {
+  if (rippleStats.micros == 0) return 0;
+  return rippleStats.cells * 1e6f / rippleStats.micros;
+}
+
+void rippleResetStats() {
+  rippleStats.cells = 0;
+  rippleStats.micros = 0;
+  rippleStats.steps = 0;
+  rippleStats.steals = 0;
+}
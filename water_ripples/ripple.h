@@ -0,0 +1,154 @@
+// Ripple stencil engine
+// Shared height field update for the water ripple sketches
+#ifndef RIPPLE_H
+#define RIPPLE_H
+
+#include <stdint.h>
+
+// How the four-neighbour average is kept within 16 bits
+enum RippleMode {
+  RIPPLE_WRAP,     // truncate to 16 bits, as the original sketches did
+  RIPPLE_SATURATE  // clamp the average at 0xffff
+};
+
+// Throughput counters, accumulated by every call to rippleStep()
+struct RippleStats {
+  unsigned long cells;
+  unsigned long micros;
+  unsigned long steps;
+  unsigned long steals; // tiles taken from another worker by rippleParallelStepTiles()
+};
+extern RippleStats rippleStats;
+
+// Advance the height field by one time step. On entry dest holds the step before source,
+// on return it holds the new step. The outer ring of cells is never written.
+// The grid is walked row by row so every access stays within three neighbouring rows,
+// and each row is processed RIPPLE_LANES cells at a time by the vector kernel.
+// Returns the number of cells updated.
+unsigned long rippleStep(const uint16_t *source, uint16_t *dest, int xdim, int ydim, int dampShift,
+                         RippleMode mode = RIPPLE_WRAP);
+
+// Out-of-place form: prev holds the step before source and dest receives the new step.
+// prev may alias dest (the in-place update above) or source (restarts the field at rest).
+// Interior cells of dest are all written, its outer ring is left as it was.
+unsigned long rippleStepFrom(const uint16_t *source, const uint16_t *prev, uint16_t *dest, int xdim, int ydim,
+                             int dampShift, RippleMode mode = RIPPLE_WRAP);
+
+// Same update restricted to rows [rowBegin, rowEnd), clipped to the interior rows.
+// Does not touch rippleStats, so several threads may run disjoint bands at once.
+unsigned long rippleStepRows(const uint16_t *source, const uint16_t *prev, uint16_t *dest, int xdim, int ydim,
+                             int dampShift, int rowBegin, int rowEnd, RippleMode mode = RIPPLE_WRAP);
+
+// Dirty tiles: the grid is split into RIPPLE_TILE x RIPPLE_TILE tiles and every field keeps a
+// bitmap of the tiles that may hold a non-zero cell. Anything written into a field outside
+// the step (sources, raindrops) must mark its tile, or it may be skipped.
+// The bitmap covers grids of up to RIPPLE_MAX_TILES tiles, and at most RIPPLE_MAX_TILE_COLUMNS
+// across (16384 cells): bigger grids still work, but rippleStepTiled() and rippleRenderTiles()
+// fall back to the full step and render for them, and tiles past the bitmap always read live.
+#define RIPPLE_TILE 16
+#define RIPPLE_MAX_TILES 8192
+#define RIPPLE_MAX_TILE_COLUMNS (RIPPLE_MAX_TILES / 8)
+struct RippleActivity {
+  uint32_t bits[RIPPLE_MAX_TILES / 32];
+};
+
+void rippleMarkAll(RippleActivity &live);
+
+// Whether the tile bitmap can track a grid this size
+inline bool rippleTilesFit(int xdim, int ydim) {
+  int tilesX = (xdim + RIPPLE_TILE-1) / RIPPLE_TILE;
+  int tilesY = (ydim + RIPPLE_TILE-1) / RIPPLE_TILE;
+  return tilesX <= RIPPLE_MAX_TILE_COLUMNS && tilesX * tilesY <= RIPPLE_MAX_TILES;
+}
+
+inline bool rippleTileLive(const RippleActivity &live, int tile) {
+  if (tile >= RIPPLE_MAX_TILES) return true;
+  return live.bits[tile >> 5] & (1u << (tile & 31));
+}
+
+inline void rippleSetTile(RippleActivity &live, int tile, bool on) {
+  if (tile >= RIPPLE_MAX_TILES) return;
+  if (on) live.bits[tile >> 5] |= 1u << (tile & 31);
+  else live.bits[tile >> 5] &= ~(1u << (tile & 31));
+}
+
+inline void rippleMarkCell(RippleActivity &live, int xdim, int x, int y) {
+  rippleSetTile(live, (y / RIPPLE_TILE) * ((xdim + RIPPLE_TILE-1) / RIPPLE_TILE) + x / RIPPLE_TILE, true);
+}
+
+// rippleStepFrom() that only computes tiles which were live one step back or border a tile
+// live in source; other tiles are known to stay zero. destLive is rewritten for the new step
+// and may be the same bitmap as prevLive when prev aliases dest. A grid too big for the bitmap
+// (see rippleTilesFit()) is stepped whole by rippleStepFrom() and destLive marked all live.
+// Returns the number of cells actually computed.
+unsigned long rippleStepTiled(const uint16_t *source, const uint16_t *prev, uint16_t *dest, int xdim, int ydim,
+                              int dampShift, RippleMode mode, const RippleActivity &sourceLive,
+                              const RippleActivity &prevLive, RippleActivity &destLive);
+
+// Temporal blocking: advances steps time steps in one pass over memory, giving the same result
+// as calling rippleStep(a, b), rippleStep(b, a), ... steps times (the newest step ends up in b
+// when steps is odd, in a when it is even). The grid is swept in column strips of stripWidth
+// cells, and within a strip all steps follow each other down the rows one row apart, so only
+// a few rows of each strip need to stay in cache. Nothing may be injected between the steps.
+// It only pays off when the two fields are too big for the data cache (fields in PSRAM on the
+// board, millions of cells on the host) and the strips are the full width: then it saves the
+// memory traffic of the extra sweeps, about 1.0-1.2x on a 2048x2048 host field. A field that
+// fits in cache, as every sketch's does, gains nothing and pays for the skewed rows, and
+// narrow strips are slower everywhere (a call per strip row and poor prefetching down the
+// columns). Measure with ripple_bench before turning it on.
+unsigned long rippleStepBlocked(uint16_t *a, uint16_t *b, int xdim, int ydim, int dampShift, RippleMode mode,
+                                int steps, int stripWidth);
+
+// Splash: every interior cell between 0x2000 and 0x5000 is raised by a random amount below
+// 0xa000 (wrapping at 16 bits), as the sketches did with random() per cell. The numbers come
+// from an inline xorshift on seed, which is advanced, so it costs a few cycles per cell.
+// Cells that are zero stay zero, so tile bitmaps stay valid.
+void rippleSplash(uint16_t *field, int xdim, int ydim, uint32_t &seed);
+
+// Bilinear resampling of one field onto a grid of a different size covering the same area,
+// used when the simulation resolution changes. The outer ring of dest is cleared.
+// source and dest must not overlap.
+void rippleResample(const uint16_t *source, int sourceX, int sourceY, uint16_t *dest, int destX, int destY);
+
+// Band-parallel stepping: the interior rows are split into one horizontal band per worker.
+// On the ESP32 each worker is a FreeRTOS task pinned to a core, on the host a std::thread.
+// rippleParallelStep() returns only when every band is done (a barrier per time step), so
+// raindrops and sources written into dest afterwards land exactly as with one thread.
+#define RIPPLE_MAX_WORKERS 16
+void rippleParallelBegin(int workers);
+unsigned long rippleParallelStep(const uint16_t *source, const uint16_t *prev, uint16_t *dest, int xdim, int ydim,
+                                 int dampShift, RippleMode mode = RIPPLE_WRAP);
+void rippleParallelEnd();
+
+// Work-stealing stepping for fields far larger than the screen, where memory bandwidth and
+// uneven progress between workers matter more than the arithmetic. The interior is cut into
+// tileX x tileY tiles and each worker starts on an equal run of them, numbered row by row.
+// A worker whose run is empty steals the back half of another's, so a worker slowed by the
+// memory bus or by other tasks on its core no longer holds up the barrier. Same result and
+// barrier as rippleParallelStep(); tiles are made taller if there are more than
+// RIPPLE_MAX_RUN_TILES of them.
+#define RIPPLE_MAX_RUN_TILES 0xffff
+unsigned long rippleParallelStepTiles(const uint16_t *source, const uint16_t *prev, uint16_t *dest, int xdim,
+                                      int ydim, int dampShift, RippleMode mode, int tileX, int tileY);
+
+// Plain one-cell-at-a-time loop, kept as the reference the vector kernel must match bit for bit
+unsigned long rippleStepScalar(const uint16_t *source, uint16_t *dest, int xdim, int ydim, int dampShift,
+                               RippleMode mode = RIPPLE_WRAP);
+
+// Runs both kernels, plain and with coefficient maps, on random height fields of assorted
+// sizes, shifts and modes and returns the number of cells where they disagree (0 means the
+// vector kernels are exact). On the ESP32-S3 a mismatch in the plain kernel also turns its
+// PIE loop off for good (see ripple_kernel.h).
+unsigned long rippleSelfTest(uint32_t seed, int trials);
+
+// Microsecond clock used for rippleStats (micros() on the board)
+unsigned long rippleMicros();
+
+// Cells per second spent inside rippleStep() since the last reset
+float rippleCellsPerSecond();
+void rippleResetStats();
+
+// Cells handled per vector instruction on this build
+extern const int RIPPLE_LANES;
+
+#endif
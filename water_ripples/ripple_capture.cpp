@@ -0,0 +1,128 @@
+// Ripple frame capture
+#include "ripple_capture.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool rippleCaptureBegin(RippleCapture &capture, int xdim, int ydim, int scale, RippleCaptureSink sink) {
+  capture.shadow = NULL;
+  if (xdim > RIPPLE_CAPTURE_MAX_X) return false;
+  capture.shadow = (uint8_t *)calloc(xdim * ydim, sizeof(uint8_t));
+  capture.xdim = xdim;
+  capture.ydim = ydim;
+  capture.scale = scale;
+  capture.palette = NULL;
+  capture.sink = sink;
+  capture.frames = 0;
+  capture.bytes = 0;
+  capture.key = false;
+  return capture.shadow != NULL;
+}
+
+void rippleCaptureEnd(RippleCapture &capture) {
+  free(capture.shadow);
+  capture.shadow = NULL;
+}
+
+// Same index rippleRender() looks the colour up with
+static inline uint8_t rippleIndex(uint16_t height) {
+  return height >> (16 - RIPPLE_LUT_BITS);
+}
+
+static inline uint8_t *ripplePut16(uint8_t *out, unsigned value) {
+  out[0] = value;
+  out[1] = value >> 8;
+  return out + 2;
+}
+
+static inline uint8_t *ripplePut32(uint8_t *out, unsigned long value) {
+  return ripplePut16(ripplePut16(out, value & 0xffff), (value >> 16) & 0xffff);
+}
+
+// Payload goes at packet + 5, this adds the framing around it and hands it to the sink
+static void rippleSendPacket(RippleCapture &capture, char type, int length) {
+  uint8_t *packet = capture.packet;
+  packet[0] = 0xa5;
+  packet[1] = 0x5a;
+  packet[2] = type;
+  ripplePut16(packet + 3, length);
+  uint16_t a = 0, b = 0;
+  for (int k = 2; k < length + 5; k++) {
+    a = (a + packet[k]) % 255;
+    b = (b + a) % 255;
+  }
+  packet[length + 5] = a;
+  packet[length + 6] = b;
+  capture.sink(packet, length + 7);
+  capture.bytes += length + 7;
+}
+
+void rippleCaptureStart(RippleCapture &capture, const RipplePalette &palette, unsigned long millis) {
+  capture.key = capture.frames % RIPPLE_CAPTURE_KEY_FRAMES == 0 || &palette != capture.palette;
+  if (capture.key) {
+    uint8_t *out = capture.packet + 5;
+    *out++ = RIPPLE_CAPTURE_VERSION;
+    out = ripplePut16(out, capture.xdim);
+    out = ripplePut16(out, capture.ydim);
+    *out++ = capture.scale;
+    // The palette holds colours byte swapped for the panel
+    for (int k = 0; k < RIPPLE_LUT_SIZE; k++) {
+      uint16_t colour = palette.colours[k];
+      out = ripplePut16(out, (uint16_t)((colour >> 8) | (colour << 8)));
+    }
+    rippleSendPacket(capture, 'H', out - (capture.packet + 5));
+    capture.palette = &palette;
+    memset(capture.shadow, 0, capture.xdim * capture.ydim);
+  }
+  uint8_t *out = ripplePut32(ripplePut32(capture.packet + 5, capture.frames), millis);
+  *out++ = capture.key;
+  rippleSendPacket(capture, 'F', out - (capture.packet + 5));
+}
+
+void rippleCaptureRow(RippleCapture &capture, const uint16_t *field, int row) {
+  const uint16_t *cells = field + row*capture.xdim;
+  uint8_t *shadow = capture.shadow + row*capture.xdim;
+  uint8_t *start = capture.packet + 5;
+  uint8_t *out = ripplePut16(start, row);
+  int i = 0;
+  int last = capture.xdim;
+  // After a key frame's reset every cell is sent, even ones already at index 0
+  bool all = capture.key;
+  while (i < last) {
+    int skip = 0;
+    while (i < last && skip < 255 && !all && rippleIndex(cells[i]) == shadow[i]) {
+      i++;
+      skip++;
+    }
+    if (i == last) break;
+    uint8_t *count = out + 1;
+    out[0] = skip;
+    out += 2;
+    int n = 0;
+    while (i < last && n < 255) {
+      uint8_t index = rippleIndex(cells[i]);
+      // Unchanged cells end the literals, unless it is a single one that is cheaper to resend
+      // than to start a new pair for
+      bool nextSame = i+1 == last || rippleIndex(cells[i+1]) == shadow[i+1];
+      if (!all && index == shadow[i] && nextSame) break;
+      shadow[i] = index;
+      *out++ = index;
+      i++;
+      n++;
+    }
+    *count = n;
+  }
+  if (out == start + 2) return; // nothing changed
+  rippleSendPacket(capture, 'R', out - start);
+}
+
+void rippleCaptureFinish(RippleCapture &capture) {
+  rippleSendPacket(capture, 'E', 0);
+  capture.frames++;
+}
+
+void rippleCaptureFrame(RippleCapture &capture, const uint16_t *field, const RipplePalette &palette,
+                        unsigned long millis) {
+  rippleCaptureStart(capture, palette, millis);
+  for (int j = 0; j < capture.ydim; j++) rippleCaptureRow(capture, field, j);
+  rippleCaptureFinish(capture);
+}
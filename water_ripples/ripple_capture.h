@@ -0,0 +1,56 @@
+// Ripple frame capture
+// Streams the frames a sketch draws as palette-index deltas in a framed binary protocol,
+// for host/ripple_viewer to turn back into an animation
+#ifndef RIPPLE_CAPTURE_H
+#define RIPPLE_CAPTURE_H
+
+#include <stdint.h>
+#include "ripple_render.h"
+
+// Every packet is
+//   0xa5 0x5a, type, payload length (2 bytes, little endian), payload, Fletcher-16 of the
+//   type, length and payload (2 bytes)
+// so a reader can find packets again after noise, and skip the text a sketch prints between them.
+//   'H' header:    version, xdim (2), ydim (2), scale, 256 RGB565 colours (2 each)
+//   'F' frame:     frame number (4), millis (4), key flag. A key frame starts from palette index 0
+//                  everywhere and follows a header, so a viewer can join at any key frame.
+//   'R' row:       row (2), then pairs of (cells unchanged, n) each followed by n palette indices,
+//                  counts up to 255. Rows with no change are not sent.
+//   'E' frame end
+// All multi-byte fields are little endian.
+#define RIPPLE_CAPTURE_VERSION 1
+#define RIPPLE_CAPTURE_MAX_X 640
+#define RIPPLE_CAPTURE_MAX_PACKET (2 * RIPPLE_CAPTURE_MAX_X + 16)
+#define RIPPLE_CAPTURE_KEY_FRAMES 100 // frames between key frames
+
+// Receives each packet as soon as it is complete, Serial.write() on the board
+typedef void (*RippleCaptureSink)(const uint8_t *data, int length);
+
+struct RippleCapture {
+  int xdim, ydim, scale;
+  uint8_t *shadow;                  // palette index last sent for every cell
+  const RipplePalette *palette;     // palette of the last header
+  RippleCaptureSink sink;
+  unsigned long frames;
+  unsigned long bytes;              // sent since rippleCaptureBegin(), for reports
+  bool key;                         // the frame being sent is a key frame
+  uint8_t packet[RIPPLE_CAPTURE_MAX_PACKET];
+};
+
+// Returns false if xdim is over RIPPLE_CAPTURE_MAX_X or the shadow cannot be allocated
+bool rippleCaptureBegin(RippleCapture &capture, int xdim, int ydim, int scale, RippleCaptureSink sink);
+void rippleCaptureEnd(RippleCapture &capture);
+
+// A frame is sent a row at a time, so the encoder's work and the serial output are spread
+// through the frame rather than arriving as one block: rippleCaptureStart(), then
+// rippleCaptureRow() for every row in any order, then rippleCaptureFinish(). Changing
+// palette forces a key frame.
+void rippleCaptureStart(RippleCapture &capture, const RipplePalette &palette, unsigned long millis);
+void rippleCaptureRow(RippleCapture &capture, const uint16_t *field, int row);
+void rippleCaptureFinish(RippleCapture &capture);
+
+// All of the above for a whole field
+void rippleCaptureFrame(RippleCapture &capture, const uint16_t *field, const RipplePalette &palette,
+                        unsigned long millis);
+
+#endif
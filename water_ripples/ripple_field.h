@@ -0,0 +1,76 @@
+// Compile-time ripple engine
+// RippleField<W, H, DampShift, Scale> fixes a sketch's grid, dampening and pixel scale as
+// template parameters, so the row kernels are inlined with constant bounds, strides and shift
+#ifndef RIPPLE_FIELD_H
+#define RIPPLE_FIELD_H
+
+#include <stdint.h>
+#include "ripple.h"
+#include "ripple_kernel.h"
+#include "ripple_map.h"
+
+template <int W, int H, int DampShift, int Scale = 1>
+struct RippleField {
+  static_assert(W >= 3 && H >= 3, "ripple field needs an interior");
+  static_assert(DampShift >= 0 && DampShift < 16, "dampening shift out of range");
+  static_assert(Scale >= 1, "scale must be at least one pixel per cell");
+
+  static constexpr int XDIM = W;
+  static constexpr int YDIM = H;
+  static constexpr int CELLS = W * H;
+  static constexpr int INTERIOR = (W-2) * (H-2);
+  static constexpr int DAMPENING = DampShift;
+  static constexpr int SCALE = Scale;
+  static constexpr int SCREEN_WIDTH = W * Scale;
+  static constexpr int SCREEN_HEIGHT = H * Scale;
+
+  static constexpr int index(int x, int y) { return y*W + x; }
+
+  // Same contract as rippleStepFrom(): prev may alias dest or source, the outer ring is left alone
+  template <RippleMode Mode = RIPPLE_WRAP>
+  static unsigned long step(const uint16_t *source, const uint16_t *prev, uint16_t *dest) {
+    unsigned long start = rippleMicros();
+    for (int j = 1; j < H-1; j++) {
+      const uint16_t *mid = source + j*W;
+      int tail = rippleRowVector(mid - W, mid, mid + W, prev + j*W, dest + j*W, 1, W-1, DampShift, Mode);
+      rippleRowScalar(mid - W, mid, mid + W, prev + j*W, dest + j*W, tail, W-1, DampShift, Mode);
+    }
+    rippleStats.micros += rippleMicros() - start;
+    rippleStats.cells += INTERIOR;
+    rippleStats.steps++;
+    return INTERIOR;
+  }
+
+  // In-place form matching rippleStep(): dest holds the step before source on entry
+  template <RippleMode Mode = RIPPLE_WRAP>
+  static unsigned long step(const uint16_t *source, uint16_t *dest) {
+    return step<Mode>(source, dest, dest);
+  }
+
+  // rippleStepMapped() with the edge mode fixed at compile time as well, so a field with
+  // RIPPLE_EDGE_FIXED does not even test for the ring refill
+  template <RippleMode Mode = RIPPLE_WRAP, RippleEdge Edge = RIPPLE_EDGE_FIXED>
+  static unsigned long step(const uint16_t *source, const uint16_t *prev, uint16_t *dest, const RippleMap &map) {
+    unsigned long start = rippleMicros();
+    for (int j = 1; j < H-1; j++) {
+      const uint16_t *mid = source + j*W;
+      const uint16_t *slow = map.slow + j*W, *loss = map.loss + j*W;
+      int tail = rippleRowMappedVector(mid - W, mid, mid + W, prev + j*W, dest + j*W, slow, loss, 1, W-1, DampShift,
+                                       Mode);
+      rippleRowMappedScalar(mid - W, mid, mid + W, prev + j*W, dest + j*W, slow, loss, tail, W-1, DampShift, Mode);
+    }
+    if (Edge != RIPPLE_EDGE_FIXED) rippleFillEdges(dest, W, H, Edge);
+    rippleStats.micros += rippleMicros() - start;
+    rippleStats.cells += INTERIOR;
+    rippleStats.steps++;
+    return INTERIOR;
+  }
+};
+
+// The sketches in this folder, one preset each
+typedef RippleField<160, 85, 11, 2> RippleClassic;  // main.cpp and ripple_v2.cpp, 2x2 pixels per cell
+typedef RippleField<320, 170, 9, 1> RippleFull;     // ripple_v3.cpp, one cell per pixel
+typedef RippleField<180, 95, 13, 2> RippleMini;     // ripple_v3_mini.cpp, drawn 5 pixels in
+typedef RippleField<90, 47, 13, 4> RippleQuarter;   // ripple_v3_mini.cpp at RESOLUTION 4, drawn smoothed
+
+#endif
@@ -0,0 +1,76 @@
+// Ripple frame-rate governor
+#include "ripple_governor.h"
+#include "ripple.h"
+#include <stdio.h>
+
+void rippleGovernorBegin(RippleGovernor &governor, int targetFps, int levels, int maxSkip, bool overlapped) {
+  governor.budget = 1000000UL / (targetFps > 0 ? targetFps : 1);
+  governor.levels = levels > 0 ? levels : 1;
+  governor.maxSkip = maxSkip > 0 ? maxSkip : 1;
+  governor.overlapped = overlapped;
+  governor.level = 0;
+  governor.renderEvery = 1;
+  governor.frames = governor.rendered = 0;
+  governor.simMicros = governor.renderMicros = 0;
+  governor.simCost = governor.renderCost = 0;
+  governor.fps = 0;
+  governor.windowStart = rippleMicros();
+}
+
+// Average microseconds per frame with the given stage costs and frame skip
+static unsigned long rippleFrameCost(const RippleGovernor &governor, unsigned long sim, unsigned long render,
+                                     int renderEvery) {
+  unsigned long drawing = render / renderEvery;
+  if (governor.overlapped) return sim > drawing ? sim : drawing;
+  return sim + drawing;
+}
+
+bool rippleGovernorFrame(RippleGovernor &governor, unsigned long simMicros, unsigned long renderMicros,
+                         bool drawn) {
+  governor.frames++;
+  governor.simMicros += simMicros;
+  if (drawn) {
+    governor.rendered++;
+    governor.renderMicros += renderMicros;
+  }
+  if (governor.frames < RIPPLE_GOVERNOR_WINDOW) return false;
+
+  unsigned long now = rippleMicros();
+  governor.fps = governor.rendered * 1e6f / (now - governor.windowStart + 1);
+  governor.simCost = governor.simMicros / governor.frames;
+  if (governor.rendered > 0) governor.renderCost = governor.renderMicros / governor.rendered;
+  governor.frames = governor.rendered = 0;
+  governor.simMicros = governor.renderMicros = 0;
+  governor.windowStart = now;
+
+  unsigned long sim = governor.simCost, render = governor.renderCost;
+  int level = governor.level;
+  if (rippleFrameCost(governor, sim, render, governor.renderEvery) > governor.budget) {
+    // Relieve whichever stage costs more, falling back to the other
+    bool simHeavier = sim > render / governor.renderEvery;
+    if ((simHeavier || governor.renderEvery == governor.maxSkip) && level < governor.levels-1) {
+      governor.level++;
+    } else if (governor.renderEvery < governor.maxSkip) {
+      governor.renderEvery++;
+    } else if (level < governor.levels-1) {
+      governor.level++;
+    }
+  } else {
+    unsigned long roomy = governor.budget * RIPPLE_GOVERNOR_HEADROOM / 100;
+    if (governor.renderEvery > 1 && rippleFrameCost(governor, sim, render, governor.renderEvery-1) < roomy) {
+      governor.renderEvery--;
+    } else if (level > 0 && rippleFrameCost(governor, sim * RIPPLE_GOVERNOR_LEVEL_COST, render,
+                                            governor.renderEvery) < roomy) {
+      governor.level--;
+    }
+  }
+  return governor.level != level;
+}
+
+void rippleGovernorDraw(TFT_eSPI &tft, const RippleGovernor &governor) {
+  char text[96];
+  snprintf(text, sizeof text, "%4.1f fps sim %lu.%lu draw %lu.%lu ms L%d 1/%d", governor.fps,
+           governor.simCost / 1000, governor.simCost / 100 % 10, governor.renderCost / 1000,
+           governor.renderCost / 100 % 10, governor.level, governor.renderEvery);
+  tft.drawString(text, 0, 0);
+}
@@ -0,0 +1,51 @@
+// Ripple frame-rate governor
+// Measures what each frame costs and trades simulation resolution and drawn frames for
+// holding a target frame rate
+#ifndef RIPPLE_GOVERNOR_H
+#define RIPPLE_GOVERNOR_H
+
+#include <stdint.h>
+#include <TFT_eSPI.h>
+
+#define RIPPLE_GOVERNOR_WINDOW 8      // frames measured before each decision
+#define RIPPLE_GOVERNOR_LEVEL_COST 4  // each finer level has twice the cells along each axis
+#define RIPPLE_GOVERNOR_HEADROOM 80   // percent of the budget a cheaper setting must fit in before it is undone
+
+struct RippleGovernor {
+  unsigned long budget;      // microseconds per frame at the target rate
+  int levels;                // simulation resolutions on offer, 0 is the finest
+  int maxSkip;               // at least one frame in this many is drawn
+  bool overlapped;           // simulation and rendering run on different cores
+  int level;                 // resolution in use
+  int renderEvery;           // one frame in this many is drawn
+  // Summed over the current window
+  int frames, rendered;
+  unsigned long simMicros, renderMicros;
+  // Results of the last window, for display
+  unsigned long simCost, renderCost;
+  float fps;
+  unsigned long windowStart;
+};
+
+// levels is 1 when the resolution is fixed and maxSkip 1 when every frame must be drawn (both 1
+// only measures). overlapped when a frame costs the larger of the two stages rather than their
+// sum, as in the pipelined sketches.
+void rippleGovernorBegin(RippleGovernor &governor, int targetFps, int levels, int maxSkip, bool overlapped = false);
+
+// Whether frame n should be drawn
+inline bool rippleGovernorDraws(const RippleGovernor &governor, unsigned long n) {
+  return n % governor.renderEvery == 0;
+}
+
+// Records one frame's costs (renderMicros is ignored when it was not drawn). At the end of each
+// window it decides: over budget, it coarsens the resolution or draws fewer frames, whichever
+// relieves the costlier stage; well under budget, it draws more frames again first and then
+// refines the resolution. Returns true when the level changed, in which case the caller must
+// resample its fields to the new resolution.
+bool rippleGovernorFrame(RippleGovernor &governor, unsigned long simMicros, unsigned long renderMicros,
+                         bool drawn);
+
+// One line of text at the top-left of the screen: drawn fps, per-stage cost, level and skip
+void rippleGovernorDraw(TFT_eSPI &tft, const RippleGovernor &governor);
+
+#endif
@@ -0,0 +1,160 @@
+// Water Ripple Simulation
+// Allan Wu (23810308)
+// 24 September 2025
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "ripple.h"
+#include "ripple_render.h"
+#include "ripple_field.h"
+#include "ripple_map.h"
+
+#define LEFT 0
+#define RIGHT 14
+
+// simulation parameters
+#define DELAY_MILLIS 50
+typedef RippleField<160, 85, 11, 2> Water; // RippleClassic's grid, drawn 2x2 pixels per cell
+#define XDIM Water::XDIM
+#define YDIM Water::YDIM
+#define NUM_SHADES 15
+#define OVERFLOW_MODE RIPPLE_SATURATE
+// RIPPLE_EDGE_ABSORB lets the swell leave the screen, RIPPLE_EDGE_FIXED bounces it back
+// and RIPPLE_EDGE_WRAP brings it in again from the other side
+#define EDGE RIPPLE_EDGE_ABSORB
+#define SWELL_FRAMES 14 // frames between swell crests
+#define SWELL_ROW 10
+#define REPORT_MILLIS 1000
+
+TFT_eSPI tft = TFT_eSPI(); // 170 x 320 pixels
+
+bool swellOn = true;
+bool rainfallOn = false;
+unsigned long rainTimer = DELAY_MILLIS;
+uint16_t buffer1[XDIM * YDIM];
+uint16_t buffer2[XDIM * YDIM];
+RippleMap harbour;
+int shades[] = {
+  0x0007,
+  0x0009,
+  0x0012,
+  0x0015,
+  0x0018,
+  0x001a,
+  0x001c,
+  0x001f,
+  0x541f,
+  0x65bf,
+  0xc71f,
+  0xd75f,
+  0xefbf,
+  0xf7df,
+  0xffff
+};
+
+RipplePalette ocean;
+
+void buildHarbour();
+void renderWater(uint16_t *dest);
+void processWater(uint16_t *source, uint16_t *dest);
+
+void setup()
+{
+  pinMode(LEFT, INPUT_PULLUP);
+  pinMode(RIGHT, INPUT_PULLUP);
+
+  Serial.begin(115200);
+  // Check the vector kernels against the scalar references before trusting them
+  if (rippleSelfTest(millis() + 1, 64) > 0) Serial.println("ripple kernel mismatch");
+  if (!rippleMapBegin(harbour, XDIM, YDIM, EDGE)) Serial.println("no memory for the harbour map");
+  buildHarbour();
+
+  tft.init();
+  tft.setRotation(3);
+  tft.fillScreen(TFT_BLACK);
+  rippleRenderBegin(tft);
+  rippleBuildPalette(ocean, shades, NUM_SHADES);
+  renderWater(buffer2);
+}
+
+void loop()
+{
+  static unsigned long lastUpdateTime = millis();
+  static unsigned long lastReportTime = millis();
+  static int prevLeft = 0, prevRight = 0;
+  static int currLeft = 0, currRight = 0;
+  static uint16_t *p1 = buffer1;
+  static uint16_t *p2 = buffer2;
+  static uint16_t *temp;
+  currLeft = !digitalRead(LEFT);
+  currRight = !digitalRead(RIGHT);
+
+  if (prevLeft && !currLeft) {
+    swellOn = !swellOn;
+  } else if (prevRight && !currRight) {
+    rainfallOn = !rainfallOn;
+    if (rainfallOn) rainTimer = 0;
+  }
+
+  if (millis() - lastUpdateTime > DELAY_MILLIS) {
+    processWater(p1, p2);
+    renderWater(p2);
+    temp = p1;
+    p1 = p2;
+    p2 = temp;
+    lastUpdateTime = millis();
+  }
+  if (millis() - lastReportTime > REPORT_MILLIS) {
+    // Simulation throughput, and the frame rate the stencil alone could sustain
+    float cellsPerSecond = rippleCellsPerSecond();
+    Serial.print(cellsPerSecond / 1000);
+    Serial.print(" kcells/s, ");
+    Serial.print(cellsPerSecond / Water::INTERIOR);
+    Serial.println(" steps/s");
+    rippleResetStats();
+    lastReportTime = millis();
+  }
+  prevLeft = currLeft;
+  prevRight = currRight;
+}
+
+// Open sea along the top, a breakwater with a mouth in the middle, a pier and moored hulls
+// inside, and a beach shelving up along the right of the harbour
+void buildHarbour() {
+  rippleMapWall(harbour, 0, 34, 68, 37);
+  rippleMapWall(harbour, 88, 34, XDIM, 37);
+  rippleMapWallDisc(harbour, 68, 35, 3); // rounded heads either side of the mouth
+  rippleMapWallDisc(harbour, 88, 35, 3);
+  rippleMapWall(harbour, 30, 50, 33, YDIM);
+  rippleMapWall(harbour, 36, 58, 42, 61);
+  rippleMapWall(harbour, 21, 66, 27, 69);
+  rippleMapWallDisc(harbour, 118, 14, 5); // a rock out at sea
+  rippleMapShallows(harbour, 100, 16, 112, 22, 0x0800, 0x8000); // a reef next to it
+  rippleMapSlope(harbour, 120, 37, XDIM, YDIM, 0, 0, 0x3000, 0xe000);
+}
+
+void renderWater(uint16_t *dest) {
+  rippleRender(tft, dest, XDIM, YDIM, ocean, Water::SCALE, 0, 0, &harbour);
+}
+
+void processWater(uint16_t *source, uint16_t *dest) {
+  static unsigned long lastRainfall = millis();
+  static int frame = 0;
+  Water::step<OVERFLOW_MODE, EDGE>(source, dest, dest, harbour);
+  // Swell: a crest along one row of the open sea, which the breakwater should mostly stop
+  if (swellOn && ++frame % SWELL_FRAMES == 0) {
+    for (int i = 1; i < XDIM-1; i++) {
+      if (harbour.loss[SWELL_ROW*XDIM + i] != 0xffff) dest[SWELL_ROW*XDIM + i] = 0xffff;
+    }
+  }
+  // Raindrops, which also land in the harbour
+  if (rainfallOn && millis() - lastRainfall > rainTimer) {
+    int repeats = random(1, 5);
+    rainTimer = random(5*DELAY_MILLIS, 20*DELAY_MILLIS);
+    while (repeats > 0) {
+      int cell = random(1, YDIM-1)*XDIM + random(1, XDIM-1);
+      if (harbour.loss[cell] != 0xffff) dest[cell] = 0xffff;
+      repeats--;
+    }
+    lastRainfall = millis();
+  }
+}
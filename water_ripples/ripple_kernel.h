@@ -0,0 +1,337 @@
+// Ripple row kernels
+// Shared by ripple.cpp and RippleField, which inlines them with its dimensions fixed
+#ifndef RIPPLE_KERNEL_H
+#define RIPPLE_KERNEL_H
+
+#include <stdint.h>
+#include <string.h>
+#include "ripple.h"
+
+#if defined(ESP_PLATFORM)
+#include "sdkconfig.h"
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RIPPLE_VECTOR_LANES 16
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define RIPPLE_VECTOR_LANES 8
+#else
+#define RIPPLE_VECTOR_LANES 8
+#endif
+
+// Reference update for cells [first, last) of one interior row: up/mid/down are the
+// source rows around the new row out, and prev is the same row one step before source.
+// prev may alias out, in which case the update happens in place.
+static inline void rippleRowScalar(const uint16_t *up, const uint16_t *mid, const uint16_t *down, const uint16_t *prev,
+                            uint16_t *out, int first, int last, int dampShift, RippleMode mode) {
+  for (int i = first; i < last; i++) {
+    int sum = (up[i] + down[i] + mid[i-1] + mid[i+1]) >> 1;
+    if (mode == RIPPLE_SATURATE && sum > 0xffff) sum = 0xffff;
+    uint16_t smoothed = sum;
+    uint16_t height = (smoothed > prev[i]) ? smoothed - prev[i] : 0;
+    uint16_t dampening = height >> dampShift;
+    out[i] = (dampening < height) ? height - dampening : 0;
+  }
+}
+
+// Update with per-cell coefficient maps (see ripple_map.h). slow blends the neighbour average
+// towards twice the cell's own height, which is where it would stay with no wave speed at all,
+// and loss removes that fraction of the new height, all of it at 0xffff. Both 0 gives exactly
+// rippleRowScalar().
+static inline void rippleRowMappedScalar(const uint16_t *up, const uint16_t *mid, const uint16_t *down,
+                                         const uint16_t *prev, uint16_t *out, const uint16_t *slow,
+                                         const uint16_t *loss, int first, int last, int dampShift, RippleMode mode) {
+  for (int i = first; i < last; i++) {
+    int sum = (up[i] + down[i] + mid[i-1] + mid[i+1]) >> 1;
+    int twice = 2 * mid[i];
+    if (mode == RIPPLE_SATURATE && sum > 0xffff) sum = 0xffff;
+    if (mode == RIPPLE_SATURATE && twice > 0xffff) twice = 0xffff;
+    uint16_t smoothed = sum;
+    smoothed -= (smoothed * (uint32_t)slow[i]) >> 16;
+    int blended = smoothed + ((uint16_t)twice * (uint32_t)slow[i] >> 16);
+    if (mode == RIPPLE_SATURATE && blended > 0xffff) blended = 0xffff;
+    smoothed = blended;
+    uint16_t height = (smoothed > prev[i]) ? smoothed - prev[i] : 0;
+    uint16_t dampening = height >> dampShift;
+    height = (dampening < height) ? height - dampening : 0;
+    uint16_t cut = ((height * (uint32_t)loss[i]) >> 16) + (loss[i] == 0xffff);
+    out[i] = (cut < height) ? height - cut : 0;
+  }
+}
+
+// The vector kernels never form the 18-bit sum. They use the identity
+//   (a+b+c+d) >> 1 == (a>>1) + (b>>1) + (c>>1) + (d>>1) + (((a&1) + (b&1) + (c&1) + (d&1)) >> 1)
+// whose terms fit in 16-bit lanes: wrapping adds give RIPPLE_WRAP, saturating adds give
+// RIPPLE_SATURATE. The two comparisons become saturating subtractions.
+#if defined(__AVX2__)
+static inline __m256i rippleSmoothed(const uint16_t *up, const uint16_t *mid, const uint16_t *down, int i,
+                                     RippleMode mode) {
+  const __m256i one = _mm256_set1_epi16(1);
+  __m256i a = _mm256_loadu_si256((const __m256i *)(up + i));
+  __m256i b = _mm256_loadu_si256((const __m256i *)(down + i));
+  __m256i c = _mm256_loadu_si256((const __m256i *)(mid + i - 1));
+  __m256i d = _mm256_loadu_si256((const __m256i *)(mid + i + 1));
+  __m256i odd = _mm256_add_epi16(_mm256_add_epi16(_mm256_and_si256(a, one), _mm256_and_si256(b, one)),
+                                 _mm256_add_epi16(_mm256_and_si256(c, one), _mm256_and_si256(d, one)));
+  odd = _mm256_srli_epi16(odd, 1);
+  a = _mm256_srli_epi16(a, 1);
+  b = _mm256_srli_epi16(b, 1);
+  c = _mm256_srli_epi16(c, 1);
+  d = _mm256_srli_epi16(d, 1);
+  if (mode == RIPPLE_SATURATE) {
+    return _mm256_adds_epu16(_mm256_adds_epu16(_mm256_adds_epu16(a, b), _mm256_adds_epu16(c, d)), odd);
+  }
+  return _mm256_add_epi16(_mm256_add_epi16(_mm256_add_epi16(a, b), _mm256_add_epi16(c, d)), odd);
+}
+
+static inline int rippleRowVector(const uint16_t *up, const uint16_t *mid, const uint16_t *down, const uint16_t *prev,
+                           uint16_t *out, int first, int last, int dampShift, RippleMode mode) {
+  const __m128i shift = _mm_cvtsi32_si128(dampShift);
+  int i = first;
+  for (; i + 16 <= last; i += 16) {
+    __m256i old = _mm256_loadu_si256((const __m256i *)(prev + i));
+    __m256i height = _mm256_subs_epu16(rippleSmoothed(up, mid, down, i, mode), old);
+    height = _mm256_subs_epu16(height, _mm256_srl_epi16(height, shift));
+    _mm256_storeu_si256((__m256i *)(out + i), height);
+  }
+  return i;
+}
+
+static inline int rippleRowMappedVector(const uint16_t *up, const uint16_t *mid, const uint16_t *down,
+                                        const uint16_t *prev, uint16_t *out, const uint16_t *slow,
+                                        const uint16_t *loss, int first, int last, int dampShift, RippleMode mode) {
+  const __m128i shift = _mm_cvtsi32_si128(dampShift);
+  const __m256i wall = _mm256_set1_epi16(-1);
+  int i = first;
+  for (; i + 16 <= last; i += 16) {
+    __m256i old = _mm256_loadu_si256((const __m256i *)(prev + i));
+    __m256i s = _mm256_loadu_si256((const __m256i *)(slow + i));
+    __m256i l = _mm256_loadu_si256((const __m256i *)(loss + i));
+    __m256i smoothed = rippleSmoothed(up, mid, down, i, mode);
+    __m256i centre = _mm256_loadu_si256((const __m256i *)(mid + i));
+    __m256i twice = (mode == RIPPLE_SATURATE) ? _mm256_adds_epu16(centre, centre) : _mm256_add_epi16(centre, centre);
+    smoothed = _mm256_sub_epi16(smoothed, _mm256_mulhi_epu16(smoothed, s));
+    smoothed = (mode == RIPPLE_SATURATE) ? _mm256_adds_epu16(smoothed, _mm256_mulhi_epu16(twice, s))
+                                         : _mm256_add_epi16(smoothed, _mm256_mulhi_epu16(twice, s));
+    __m256i height = _mm256_subs_epu16(smoothed, old);
+    height = _mm256_subs_epu16(height, _mm256_srl_epi16(height, shift));
+    __m256i cut = _mm256_sub_epi16(_mm256_mulhi_epu16(height, l), _mm256_cmpeq_epi16(l, wall));
+    _mm256_storeu_si256((__m256i *)(out + i), _mm256_subs_epu16(height, cut));
+  }
+  return i;
+}
+#elif defined(__SSE2__)
+static inline __m128i rippleSmoothed(const uint16_t *up, const uint16_t *mid, const uint16_t *down, int i,
+                                     RippleMode mode) {
+  const __m128i one = _mm_set1_epi16(1);
+  __m128i a = _mm_loadu_si128((const __m128i *)(up + i));
+  __m128i b = _mm_loadu_si128((const __m128i *)(down + i));
+  __m128i c = _mm_loadu_si128((const __m128i *)(mid + i - 1));
+  __m128i d = _mm_loadu_si128((const __m128i *)(mid + i + 1));
+  __m128i odd = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a, one), _mm_and_si128(b, one)),
+                              _mm_add_epi16(_mm_and_si128(c, one), _mm_and_si128(d, one)));
+  odd = _mm_srli_epi16(odd, 1);
+  a = _mm_srli_epi16(a, 1);
+  b = _mm_srli_epi16(b, 1);
+  c = _mm_srli_epi16(c, 1);
+  d = _mm_srli_epi16(d, 1);
+  if (mode == RIPPLE_SATURATE) {
+    return _mm_adds_epu16(_mm_adds_epu16(_mm_adds_epu16(a, b), _mm_adds_epu16(c, d)), odd);
+  }
+  return _mm_add_epi16(_mm_add_epi16(_mm_add_epi16(a, b), _mm_add_epi16(c, d)), odd);
+}
+
+static inline int rippleRowVector(const uint16_t *up, const uint16_t *mid, const uint16_t *down, const uint16_t *prev,
+                           uint16_t *out, int first, int last, int dampShift, RippleMode mode) {
+  const __m128i shift = _mm_cvtsi32_si128(dampShift);
+  int i = first;
+  for (; i + 8 <= last; i += 8) {
+    __m128i old = _mm_loadu_si128((const __m128i *)(prev + i));
+    __m128i height = _mm_subs_epu16(rippleSmoothed(up, mid, down, i, mode), old);
+    height = _mm_subs_epu16(height, _mm_srl_epi16(height, shift));
+    _mm_storeu_si128((__m128i *)(out + i), height);
+  }
+  return i;
+}
+
+static inline int rippleRowMappedVector(const uint16_t *up, const uint16_t *mid, const uint16_t *down,
+                                        const uint16_t *prev, uint16_t *out, const uint16_t *slow,
+                                        const uint16_t *loss, int first, int last, int dampShift, RippleMode mode) {
+  const __m128i shift = _mm_cvtsi32_si128(dampShift);
+  const __m128i wall = _mm_set1_epi16(-1);
+  int i = first;
+  for (; i + 8 <= last; i += 8) {
+    __m128i old = _mm_loadu_si128((const __m128i *)(prev + i));
+    __m128i s = _mm_loadu_si128((const __m128i *)(slow + i));
+    __m128i l = _mm_loadu_si128((const __m128i *)(loss + i));
+    __m128i smoothed = rippleSmoothed(up, mid, down, i, mode);
+    __m128i centre = _mm_loadu_si128((const __m128i *)(mid + i));
+    __m128i twice = (mode == RIPPLE_SATURATE) ? _mm_adds_epu16(centre, centre) : _mm_add_epi16(centre, centre);
+    smoothed = _mm_sub_epi16(smoothed, _mm_mulhi_epu16(smoothed, s));
+    smoothed = (mode == RIPPLE_SATURATE) ? _mm_adds_epu16(smoothed, _mm_mulhi_epu16(twice, s))
+                                         : _mm_add_epi16(smoothed, _mm_mulhi_epu16(twice, s));
+    __m128i height = _mm_subs_epu16(smoothed, old);
+    height = _mm_subs_epu16(height, _mm_srl_epi16(height, shift));
+    __m128i cut = _mm_sub_epi16(_mm_mulhi_epu16(height, l), _mm_cmpeq_epi16(l, wall));
+    _mm_storeu_si128((__m128i *)(out + i), _mm_subs_epu16(height, cut));
+  }
+  return i;
+}
+#else
+// GCC generic vectors for targets without x86 intrinsics. GCC never emits the ESP32-S3 PIE
+// instructions for them, so on that chip rippleRowVector() hands the row to an asm loop instead.
+typedef uint16_t rippleVec __attribute__((vector_size(16)));
+
+static inline rippleVec rippleAddSat(rippleVec x, rippleVec y) {
+  rippleVec s = x + y;
+  return s | (rippleVec)(s < x);
+}
+
+static inline rippleVec rippleSubSat(rippleVec x, rippleVec y) {
+  return (x - y) & (rippleVec)(x > y);
+}
+
+typedef uint32_t rippleWide __attribute__((vector_size(32)));
+
+static inline rippleVec rippleMulHigh(rippleVec x, rippleVec y) {
+  rippleWide product = __builtin_convertvector(x, rippleWide) * __builtin_convertvector(y, rippleWide);
+  return __builtin_convertvector(product >> 16, rippleVec);
+}
+
+static inline rippleVec rippleSmoothed(const uint16_t *up, const uint16_t *mid, const uint16_t *down, int i,
+                                       RippleMode mode) {
+  rippleVec a, b, c, d;
+  memcpy(&a, up + i, sizeof a);
+  memcpy(&b, down + i, sizeof b);
+  memcpy(&c, mid + i - 1, sizeof c);
+  memcpy(&d, mid + i + 1, sizeof d);
+  rippleVec odd = ((a & 1) + (b & 1) + (c & 1) + (d & 1)) >> 1;
+  a >>= 1;
+  b >>= 1;
+  c >>= 1;
+  d >>= 1;
+  if (mode == RIPPLE_SATURATE) return rippleAddSat(rippleAddSat(rippleAddSat(a, b), rippleAddSat(c, d)), odd);
+  return a + b + c + d + odd;
+}
+
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+#define RIPPLE_PIE 1
+
+// Cleared by rippleSelfTest() if the PIE loop disagrees with rippleRowScalar()
+extern bool rippleUsePie;
+
+// Loads the 8 cells at ptr, which need not be aligned, and widens them to 32 bits: lanes 0-3
+// end up in lo and lanes 4-7 in hi. It reads the aligned block holding ptr and the one after.
+#define RIPPLE_PIE_LOAD(lo, hi, ptr) \
+  "ee.ld.128.usar.ip " #lo ", %[" #ptr "], 16\n" \
+  "ee.vld.128.ip " #hi ", %[" #ptr "], 0\n" \
+  "ee.src.q " #lo ", " #lo ", " #hi "\n" \
+  "ee.zero.q " #hi "\n" \
+  "ee.vzip.16 " #lo ", " #hi "\n"
+
+// The PIE has saturating adds only for signed lanes, so instead of the split sum used above the
+// loop works in exact 32-bit lanes, 4 cells per register, and packs the 8 results back into
+// 16 bits for one aligned store. The sum is clamped to cap, then masked to 16 bits: a cap of
+// 0xffff saturates and one above the largest sum wraps. Cells before the first aligned one
+// are done by rippleRowScalar(). The second block of each load starts at most one cell past
+// the 8 it needs, which for an interior row is still inside the field. The whole loop is one
+// asm statement, as GCC knows nothing of the Q registers and would not keep them live between
+// statements.
+static inline int rippleRowPie(const uint16_t *up, const uint16_t *mid, const uint16_t *down, const uint16_t *prev,
+                               uint16_t *out, int first, int last, int dampShift, RippleMode mode) {
+  static const uint32_t low = 0xffff, saturate = 0xffff, wrap = 0x1ffff;
+  int i = first;
+  while (i < last && ((uintptr_t)(out + i) & 15)) i++;
+  int blocks = (last - i) / 8;
+  if (blocks <= 0) return first;
+  rippleRowScalar(up, mid, down, prev, out, first, i, dampShift, mode);
+  const uint16_t *a = up + i, *b = down + i, *c = mid + i - 1, *d = mid + i + 1, *old = prev + i;
+  uint16_t *dest = out + i;
+  int n = blocks;
+  __asm__ volatile(
+    "ee.vldbc.32 q6, %[cap]\n"
+    "ee.vldbc.32 q7, %[low]\n"
+    "1:\n"
+    RIPPLE_PIE_LOAD(q0, q1, a)
+    RIPPLE_PIE_LOAD(q2, q3, b)
+    "ee.vadds.s32 q0, q0, q2\n"
+    "ee.vadds.s32 q1, q1, q3\n"
+    RIPPLE_PIE_LOAD(q2, q3, c)
+    "ee.vadds.s32 q0, q0, q2\n"
+    "ee.vadds.s32 q1, q1, q3\n"
+    RIPPLE_PIE_LOAD(q2, q3, d)
+    "ee.vadds.s32 q0, q0, q2\n"
+    "ee.vadds.s32 q1, q1, q3\n"
+    "ssai 1\n"
+    "ee.vsr.32 q0, q0\n"
+    "ee.vsr.32 q1, q1\n"
+    "ee.vmin.s32 q0, q0, q6\n"
+    "ee.vmin.s32 q1, q1, q6\n"
+    "ee.andq q0, q0, q7\n"
+    "ee.andq q1, q1, q7\n"
+    RIPPLE_PIE_LOAD(q2, q3, old)
+    "ee.vsubs.s32 q0, q0, q2\n"
+    "ee.vsubs.s32 q1, q1, q3\n"
+    "ee.zero.q q2\n"
+    "ee.vmax.s32 q0, q0, q2\n"
+    "ee.vmax.s32 q1, q1, q2\n"
+    "ssr %[shift]\n"
+    "ee.vsr.32 q2, q0\n"
+    "ee.vsr.32 q3, q1\n"
+    "ee.vsubs.s32 q0, q0, q2\n"
+    "ee.vsubs.s32 q1, q1, q3\n"
+    "ee.vunzip.16 q0, q1\n"
+    "ee.vst.128.ip q0, %[dest], 16\n"
+    "addi %[n], %[n], -1\n"
+    "bnez %[n], 1b\n"
+    : [a] "+r"(a), [b] "+r"(b), [c] "+r"(c), [d] "+r"(d), [old] "+r"(old), [dest] "+r"(dest), [n] "+r"(n)
+    : [cap] "r"(mode == RIPPLE_SATURATE ? &saturate : &wrap), [low] "r"(&low), [shift] "r"(dampShift)
+    : "memory");
+  return i + blocks * 8;
+}
+#endif
+
+static inline int rippleRowVector(const uint16_t *up, const uint16_t *mid, const uint16_t *down, const uint16_t *prev,
+                           uint16_t *out, int first, int last, int dampShift, RippleMode mode) {
+#if defined(RIPPLE_PIE)
+  if (rippleUsePie) return rippleRowPie(up, mid, down, prev, out, first, last, dampShift, mode);
+#endif
+  int i = first;
+  for (; i + 8 <= last; i += 8) {
+    rippleVec old;
+    memcpy(&old, prev + i, sizeof old);
+    rippleVec height = rippleSubSat(rippleSmoothed(up, mid, down, i, mode), old);
+    height = rippleSubSat(height, height >> dampShift);
+    memcpy(out + i, &height, sizeof height);
+  }
+  return i;
+}
+
+static inline int rippleRowMappedVector(const uint16_t *up, const uint16_t *mid, const uint16_t *down,
+                                        const uint16_t *prev, uint16_t *out, const uint16_t *slow,
+                                        const uint16_t *loss, int first, int last, int dampShift, RippleMode mode) {
+  int i = first;
+  for (; i + 8 <= last; i += 8) {
+    rippleVec old, s, l, centre;
+    memcpy(&old, prev + i, sizeof old);
+    memcpy(&s, slow + i, sizeof s);
+    memcpy(&l, loss + i, sizeof l);
+    memcpy(&centre, mid + i, sizeof centre);
+    rippleVec smoothed = rippleSmoothed(up, mid, down, i, mode);
+    rippleVec twice = (mode == RIPPLE_SATURATE) ? rippleAddSat(centre, centre) : centre + centre;
+    smoothed -= rippleMulHigh(smoothed, s);
+    smoothed = (mode == RIPPLE_SATURATE) ? rippleAddSat(smoothed, rippleMulHigh(twice, s))
+                                         : smoothed + rippleMulHigh(twice, s);
+    rippleVec height = rippleSubSat(smoothed, old);
+    height = rippleSubSat(height, height >> dampShift);
+    rippleVec cut = rippleMulHigh(height, l) - (rippleVec)(l == 0xffff);
+    height = rippleSubSat(height, cut);
+    memcpy(out + i, &height, sizeof height);
+  }
+  return i;
+}
+#endif
+
+#endif
@@ -0,0 +1,110 @@
+// Ripple coefficient maps
+#include "ripple_map.h"
+#include "ripple_kernel.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void rippleMapSponge(RippleMap &map) {
+  for (int j = 0; j < map.ydim; j++) {
+    for (int i = 0; i < map.xdim; i++) {
+      // Distance from the ring, the first interior cell being 0
+      int edge = i - 1;
+      if (map.xdim-2 - i < edge) edge = map.xdim-2 - i;
+      if (j - 1 < edge) edge = j - 1;
+      if (map.ydim-2 - j < edge) edge = map.ydim-2 - j;
+      if (edge < 0 || edge >= RIPPLE_SPONGE_WIDTH) continue;
+      // Rises with the square of the depth into the sponge, so there is no sharp step to reflect off
+      uint32_t depth = RIPPLE_SPONGE_WIDTH - edge;
+      uint16_t loss = RIPPLE_SPONGE_LOSS * depth * depth / (RIPPLE_SPONGE_WIDTH * RIPPLE_SPONGE_WIDTH);
+      uint16_t &cell = map.loss[j*map.xdim + i];
+      if (loss > cell) cell = loss;
+    }
+  }
+}
+
+bool rippleMapBegin(RippleMap &map, int xdim, int ydim, RippleEdge edge) {
+  map.loss = (uint16_t *)calloc(xdim * ydim, sizeof(uint16_t));
+  map.slow = (uint16_t *)calloc(xdim * ydim, sizeof(uint16_t));
+  map.xdim = xdim;
+  map.ydim = ydim;
+  if (!map.loss || !map.slow) {
+    rippleMapEnd(map);
+    return false;
+  }
+  if (edge == RIPPLE_EDGE_ABSORB) rippleMapSponge(map);
+  return true;
+}
+
+void rippleMapEnd(RippleMap &map) {
+  free(map.loss);
+  free(map.slow);
+  map.loss = map.slow = NULL;
+}
+
+void rippleMapSlope(RippleMap &map, int x0, int y0, int x1, int y1, uint16_t loss0, uint16_t slow0, uint16_t loss1,
+                    uint16_t slow1) {
+  int span = x1 - x0 > 1 ? x1 - x0 - 1 : 1;
+  int first = x0 < 0 ? 0 : x0;
+  if (x1 > map.xdim) x1 = map.xdim;
+  if (y0 < 0) y0 = 0;
+  if (y1 > map.ydim) y1 = map.ydim;
+  for (int j = y0; j < y1; j++) {
+    for (int i = first; i < x1; i++) {
+      map.loss[j*map.xdim + i] = loss0 + (long)(loss1 - loss0) * (i - x0) / span;
+      map.slow[j*map.xdim + i] = slow0 + (long)(slow1 - slow0) * (i - x0) / span;
+    }
+  }
+}
+
+void rippleMapShallows(RippleMap &map, int x0, int y0, int x1, int y1, uint16_t loss, uint16_t slow) {
+  rippleMapSlope(map, x0, y0, x1, y1, loss, slow, loss, slow);
+}
+
+void rippleMapWall(RippleMap &map, int x0, int y0, int x1, int y1) {
+  rippleMapShallows(map, x0, y0, x1, y1, 0xffff, 0);
+}
+
+void rippleMapWallDisc(RippleMap &map, int centreX, int centreY, int radius) {
+  for (int j = centreY - radius; j <= centreY + radius; j++) {
+    for (int i = centreX - radius; i <= centreX + radius; i++) {
+      int dx = i - centreX, dy = j - centreY;
+      if (dx*dx + dy*dy <= radius*radius) rippleMapWall(map, i, j, i+1, j+1);
+    }
+  }
+}
+
+void rippleFillEdges(uint16_t *field, int xdim, int ydim, RippleEdge edge) {
+  if (edge == RIPPLE_EDGE_FIXED || xdim < 3 || ydim < 3) return;
+  // Which interior row or column each side copies. Rows go first so the column pass also
+  // fills the corners from the rows just copied.
+  bool wrap = edge == RIPPLE_EDGE_WRAP;
+  int top = wrap ? ydim-2 : 1, bottom = wrap ? 1 : ydim-2;
+  int left = wrap ? xdim-2 : 1, right = wrap ? 1 : xdim-2;
+  memcpy(field, field + top*xdim, xdim * sizeof(uint16_t));
+  memcpy(field + (ydim-1)*xdim, field + bottom*xdim, xdim * sizeof(uint16_t));
+  for (int j = 0; j < ydim; j++) {
+    uint16_t *row = field + j*xdim;
+    row[0] = row[left];
+    row[xdim-1] = row[right];
+  }
+}
+
+unsigned long rippleStepMapped(const uint16_t *source, const uint16_t *prev, uint16_t *dest, int xdim, int ydim,
+                               int dampShift, RippleMode mode, const RippleMap &map, RippleEdge edge) {
+  if (xdim < 3 || ydim < 3) return 0;
+  unsigned long start = rippleMicros();
+  for (int j = 1; j < ydim-1; j++) {
+    const uint16_t *mid = source + j*xdim;
+    const uint16_t *slow = map.slow + j*xdim, *loss = map.loss + j*xdim;
+    int tail = rippleRowMappedVector(mid - xdim, mid, mid + xdim, prev + j*xdim, dest + j*xdim, slow, loss, 1, xdim-1,
+                                     dampShift, mode);
+    rippleRowMappedScalar(mid - xdim, mid, mid + xdim, prev + j*xdim, dest + j*xdim, slow, loss, tail, xdim-1,
+                          dampShift, mode);
+  }
+  rippleFillEdges(dest, xdim, ydim, edge);
+  unsigned long cells = (unsigned long)(ydim-2) * (xdim-2);
+  rippleStats.cells += cells;
+  rippleStats.micros += rippleMicros() - start;
+  rippleStats.steps++;
+  return cells;
+}
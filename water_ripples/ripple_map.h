@@ -0,0 +1,53 @@
+// Ripple coefficient maps
+// Per-cell walls, shallows and wave speed for the ripple engine, and the edge modes that
+// fill the ring of ghost cells around the grid
+#ifndef RIPPLE_MAP_H
+#define RIPPLE_MAP_H
+
+#include <stdint.h>
+#include "ripple.h"
+
+// What the outer ring of cells holds. The stencil reads it like any other cell, so the row
+// kernels never test for an edge; each mode only decides how the ring is filled after a step.
+enum RippleEdge {
+  RIPPLE_EDGE_FIXED,  // the ring stays as it is (zero), waves reflect inverted as in the sketches
+  RIPPLE_EDGE_WRAP,   // the ring repeats the opposite interior edge, waves leave one side and enter the other
+  RIPPLE_EDGE_ABSORB  // the ring repeats the next interior cell, and the map has a sponge along the edge
+};
+
+// Cells of the sponge RIPPLE_EDGE_ABSORB adds to a map, and its loss at the outermost cell
+#define RIPPLE_SPONGE_WIDTH 8
+#define RIPPLE_SPONGE_LOSS 0x4000
+
+// Two planes of xdim*ydim fractions in 1/65536ths, so a row of either loads like a row of heights.
+//   loss: removed from the new height every step. 0 is open water, 0xffff is a wall (always zero).
+//   slow: how much of the wave speed is lost. 0 is open water, 0xc000 moves at half speed.
+struct RippleMap {
+  uint16_t *loss;
+  uint16_t *slow;
+  int xdim, ydim;
+};
+
+// Allocates both planes as open water, with the sponge when edge is RIPPLE_EDGE_ABSORB.
+// Returns false if there is not enough memory.
+bool rippleMapBegin(RippleMap &map, int xdim, int ydim, RippleEdge edge);
+void rippleMapEnd(RippleMap &map);
+
+// Scenery, on the cells [x0, x1) x [y0, y1) clipped to the grid
+void rippleMapWall(RippleMap &map, int x0, int y0, int x1, int y1);
+void rippleMapShallows(RippleMap &map, int x0, int y0, int x1, int y1, uint16_t loss, uint16_t slow);
+// Shallows getting steadily shallower along x from (loss0, slow0) at x0 to (loss1, slow1) at x1, a beach
+void rippleMapSlope(RippleMap &map, int x0, int y0, int x1, int y1, uint16_t loss0, uint16_t slow0, uint16_t loss1,
+                    uint16_t slow1);
+void rippleMapWallDisc(RippleMap &map, int centreX, int centreY, int radius);
+
+// Rewrites the outer ring of field for the edge mode (nothing for RIPPLE_EDGE_FIXED)
+void rippleFillEdges(uint16_t *field, int xdim, int ydim, RippleEdge edge);
+
+// rippleStepFrom() with the map applied to every cell and the ring of dest refilled for edge.
+// The map must have the field's dimensions. With an open map and RIPPLE_EDGE_FIXED the result
+// is identical to rippleStepFrom(). Counts towards rippleStats.
+unsigned long rippleStepMapped(const uint16_t *source, const uint16_t *prev, uint16_t *dest, int xdim, int ydim,
+                               int dampShift, RippleMode mode, const RippleMap &map, RippleEdge edge);
+
+#endif
@@ -0,0 +1,217 @@
+// Water Ripple Simulation
+// Allan Wu (23810308)
+// 24 September 2025
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include "ripple.h"
+#include "ripple_render.h"
+#include "ripple_governor.h"
+
+#define LEFT 0
+#define RIGHT 14
+// Analog joystick pins, -1 when none is fitted. A deflected stick steers the viewport
+// directly, the buttons are used otherwise.
+#define JOYSTICK_X -1
+#define JOYSTICK_Y -1
+#define JOYSTICK_DEAD_ZONE 256
+
+// simulation parameters
+#define DELAY_MILLIS 50
+// The ocean is simulated in full and the screen shows a 320x170 window onto it. Both fields
+// live in PSRAM on the board, 6 MB at the default size; override on the host for larger seas.
+#ifndef WORLD_X
+#define WORLD_X 1536
+#endif
+#ifndef WORLD_Y
+#define WORLD_Y 1024
+#endif
+#define VIEW_X 320
+#define VIEW_Y 170
+#define DAMPENING 9
+#define NUM_SHADES 15
+#define OVERFLOW_MODE RIPPLE_SATURATE
+#define NUM_WORKERS 2 // work-stealing tiles, one worker per core
+#define TILE_X 256
+#define TILE_Y 16
+#define PAN_SPEED 4 // pixels per frame
+#define RAINDROPS 8 // per frame, anywhere on the ocean
+#define REPORT_MILLIS 1000
+
+TFT_eSPI tft = TFT_eSPI(); // 170 x 320 pixels
+
+int worldX = WORLD_X;
+int worldY = WORLD_Y;
+uint16_t *buffer1;
+uint16_t *buffer2;
+// Top-left cell of the viewport, and the heading it drifts along (see headingX/headingY)
+int viewX = (WORLD_X - VIEW_X) / 2;
+int viewY = (WORLD_Y - VIEW_Y) / 2;
+int heading = 0;
+RippleGovernor governor;
+const int headingX[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+const int headingY[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+int shades[] = {
+  0x0007,
+  0x0009,
+  0x0012,
+  0x0015,
+  0x0018,
+  0x001a,
+  0x001c,
+  0x001f,
+  0x541f,
+  0x65bf,
+  0xc71f,
+  0xd75f,
+  0xefbf,
+  0xf7df,
+  0xffff
+};
+
+RipplePalette ocean;
+
+uint16_t *allocateField(int cells);
+void renderWater(uint16_t *dest);
+void processWater(uint16_t *source, uint16_t *dest);
+void panView(bool left, bool right);
+
+void setup()
+{
+  pinMode(LEFT, INPUT_PULLUP);
+  pinMode(RIGHT, INPUT_PULLUP);
+
+  Serial.begin(115200);
+  // Check the vector kernel against the scalar reference before trusting it
+  if (rippleSelfTest(millis() + 1, 64) > 0) Serial.println("ripple kernel mismatch");
+
+  // Shrink the ocean until both fields fit, it never gets smaller than the screen
+  for (;;) {
+    buffer1 = allocateField(worldX * worldY);
+    buffer2 = allocateField(worldX * worldY);
+    if ((buffer1 && buffer2) || (worldX <= VIEW_X && worldY <= VIEW_Y)) break;
+    free(buffer1);
+    free(buffer2);
+    worldX = max(VIEW_X, worldX / 2);
+    worldY = max(VIEW_Y, worldY / 2);
+  }
+  if (!buffer1 || !buffer2) Serial.println("ocean does not fit in memory");
+  viewX = (worldX - VIEW_X) / 2;
+  viewY = (worldY - VIEW_Y) / 2;
+  Serial.print("ocean ");
+  Serial.print(worldX);
+  Serial.print("x");
+  Serial.println(worldY);
+
+  tft.init();
+  tft.setRotation(3);
+  tft.fillScreen(TFT_BLACK);
+  tft.setTextSize(1);
+  tft.setTextColor(TFT_WHITE, TFT_BLACK);
+  rippleRenderBegin(tft);
+  rippleBuildPalette(ocean, shades, NUM_SHADES);
+  renderWater(buffer2);
+
+  // Measures only: the ocean's size is the point, so nothing is traded away
+  rippleGovernorBegin(governor, 1000 / DELAY_MILLIS, 1, 1);
+  rippleParallelBegin(NUM_WORKERS);
+}
+
+void loop()
+{
+  static unsigned long lastUpdateTime = millis();
+  static unsigned long lastReportTime = millis();
+  static int prevLeft = 0, prevRight = 0;
+  static int currLeft = 0, currRight = 0;
+  static bool holdingBoth = false;
+  static uint16_t *p1 = buffer1;
+  static uint16_t *p2 = buffer2;
+  static uint16_t *temp;
+  currLeft = !digitalRead(LEFT);
+  currRight = !digitalRead(RIGHT);
+
+  // A click turns the heading 45 degrees. Holding both stops the view, and letting go of
+  // them afterwards is not a click.
+  if (currLeft && currRight) holdingBoth = true;
+  if (!holdingBoth && prevLeft && !currLeft) {
+    heading = (heading + 7) % 8;
+  } else if (!holdingBoth && prevRight && !currRight) {
+    heading = (heading + 1) % 8;
+  }
+  if (!currLeft && !currRight) holdingBoth = false;
+
+  if (millis() - lastUpdateTime > DELAY_MILLIS) {
+    unsigned long start = micros();
+    processWater(p1, p2);
+    unsigned long simulated = micros();
+    panView(currLeft, currRight);
+    renderWater(p2);
+    rippleGovernorDraw(tft, governor);
+    rippleGovernorFrame(governor, simulated - start, micros() - simulated, true);
+    temp = p1;
+    p1 = p2;
+    p2 = temp;
+    lastUpdateTime = millis();
+  }
+  if (millis() - lastReportTime > REPORT_MILLIS) {
+    // Simulation throughput over the whole ocean, and how often a worker ran out of tiles
+    float cellsPerSecond = rippleCellsPerSecond();
+    Serial.print(cellsPerSecond / 1000);
+    Serial.print(" kcells/s, ");
+    Serial.print(cellsPerSecond / ((float)(worldX-2)*(worldY-2)));
+    Serial.print(" steps/s, ");
+    Serial.print((float)rippleStats.steals / max(1UL, rippleStats.steps));
+    Serial.println(" tiles stolen per step");
+    rippleResetStats();
+    lastReportTime = millis();
+  }
+  prevLeft = currLeft;
+  prevRight = currRight;
+}
+
+// Both fields start calm, in PSRAM when the board has it
+uint16_t *allocateField(int cells) {
+#ifdef ESP32
+  if (psramFound()) return (uint16_t *)ps_calloc(cells, sizeof(uint16_t));
+#endif
+  return (uint16_t *)calloc(cells, sizeof(uint16_t));
+}
+
+void renderWater(uint16_t *dest) {
+  rippleRender(tft, dest, worldX, worldY, ocean, 1, viewX, viewY);
+}
+
+void processWater(uint16_t *source, uint16_t *dest) {
+  rippleParallelStepTiles(source, dest, dest, worldX, worldY, DAMPENING, OVERFLOW_MODE, TILE_X, TILE_Y);
+  // The boat sits at the centre of the screen and leaves a wake as the view moves
+  dest[(viewY + VIEW_Y/2)*worldX + viewX + VIEW_X/2] = 0xffff;
+  // Rain falls everywhere, so there is always something to pan to
+  for (int k = 0; k < RAINDROPS; k++) {
+    dest[random(1, worldY-1)*worldX + random(1, worldX-1)] = 0xffff;
+  }
+}
+
+// Moves the viewport one frame along the heading, or as the joystick points. It bounces off
+// the edges of the ocean, and holding both buttons keeps it still.
+void panView(bool left, bool right) {
+  int dx = headingX[heading] * PAN_SPEED;
+  int dy = headingY[heading] * PAN_SPEED;
+  if (left && right) dx = dy = 0;
+#if JOYSTICK_X >= 0 && JOYSTICK_Y >= 0
+  int stickX = analogRead(JOYSTICK_X) - 2048;
+  int stickY = analogRead(JOYSTICK_Y) - 2048;
+  if (abs(stickX) > JOYSTICK_DEAD_ZONE || abs(stickY) > JOYSTICK_DEAD_ZONE) {
+    dx = stickX * 2*PAN_SPEED / 2048;
+    dy = stickY * 2*PAN_SPEED / 2048;
+  }
+#endif
+  if (viewX + dx < 0 || viewX + dx > worldX - VIEW_X) {
+    heading = (12 - heading) % 8; // mirror left to right
+    dx = -dx;
+  }
+  if (viewY + dy < 0 || viewY + dy > worldY - VIEW_Y) {
+    heading = (8 - heading) % 8; // mirror top to bottom
+    dy = -dy;
+  }
+  viewX = min(max(viewX + dx, 0), worldX - VIEW_X);
+  viewY = min(max(viewY + dy, 0), worldY - VIEW_Y);
+}
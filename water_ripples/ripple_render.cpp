@@ -0,0 +1,309 @@
+// Ripple renderer
+#include "ripple_render.h"
+#include "ripple_kernel.h"
+#include <string.h>
+
+#ifdef RIPPLE_DMA
+static uint16_t rippleStrips[2][RIPPLE_STRIP_ROWS * RIPPLE_MAX_WIDTH];
+#else
+static uint16_t rippleStrips[1][RIPPLE_STRIP_ROWS * RIPPLE_MAX_WIDTH];
+#endif
+static int rippleStripIndex = 0;
+
+// rippleRenderSmooth(): one row of cells blended vertically, and for each pixel of a line
+// the cell to its left (relative to the first cell used) and its 8-bit horizontal weight
+static uint16_t rippleSpan[RIPPLE_MAX_WIDTH + 2];
+static uint16_t rippleColumnCell[RIPPLE_MAX_WIDTH];
+static uint8_t rippleColumnWeight[RIPPLE_MAX_WIDTH];
+
+void rippleRenderBegin(TFT_eSPI &tft) {
+  // Pixels are stored byte swapped, so neither push path has to swap them
+  tft.setSwapBytes(false);
+#ifdef RIPPLE_DMA
+  tft.initDMA();
+#endif
+}
+
+static const int rippleLavaShades[] = {
+  0x0000,
+  0x2000,
+  0x4000,
+  0x7800,
+  0xa000,
+  0xc800,
+  0xf800,
+  0xf9e0,
+  0xfb20,
+  0xfc60,
+  0xfda0,
+  0xfea0,
+  0xffe0,
+  0xfff0,
+  0xffff
+};
+
+void rippleBuildPalette(RipplePalette &palette, const int *shades, int numShades) {
+  for (int k = 0; k < RIPPLE_LUT_SIZE; k++) {
+    uint16_t colour = shades[k * numShades / RIPPLE_LUT_SIZE];
+    palette.colours[k] = (colour >> 8) | (colour << 8);
+  }
+  uint16_t land = RIPPLE_LAND_COLOUR;
+  palette.land = (land >> 8) | (land << 8);
+}
+
+void rippleLavaPalette(RipplePalette &palette) {
+  rippleBuildPalette(palette, rippleLavaShades, sizeof(rippleLavaShades) / sizeof(rippleLavaShades[0]));
+}
+
+void rippleGreyPalette(RipplePalette &palette) {
+  for (int k = 0; k < RIPPLE_LUT_SIZE; k++) {
+    int level = k * 32 / RIPPLE_LUT_SIZE;
+    uint16_t colour = (level << 11) | (2*level << 5) | level;
+    palette.colours[k] = (colour >> 8) | (colour << 8);
+  }
+  uint16_t land = RIPPLE_LAND_COLOUR;
+  palette.land = (land >> 8) | (land << 8);
+}
+
+static inline uint16_t rippleShade(uint16_t height, const RipplePalette &palette) {
+  return palette.colours[height >> (16 - RIPPLE_LUT_BITS)];
+}
+
+static void ripplePushRect(TFT_eSPI &tft, int x, int y, int width, int rows) {
+  uint16_t *strip = rippleStrips[rippleStripIndex];
+#ifdef RIPPLE_DMA
+  // Waits for the previous strip, then returns while this one is still being sent
+  tft.pushImageDMA(x, y, width, rows, strip);
+  rippleStripIndex ^= 1;
+#else
+  tft.pushImage(x, y, width, rows, strip);
+#endif
+}
+
+void rippleRender(TFT_eSPI &tft, const uint16_t *field, int xdim, int ydim, const RipplePalette &palette,
+                  int scale, int offsetX, int offsetY, const RippleMap *map) {
+  int width = xdim*scale - offsetX;
+  int height = ydim*scale - offsetY;
+  if (width > tft.width()) width = tft.width();
+  if (width > RIPPLE_MAX_WIDTH) width = RIPPLE_MAX_WIDTH;
+  if (height > tft.height()) height = tft.height();
+  if (width <= 0 || height <= 0) return;
+
+  tft.startWrite();
+  int rows = 0;
+  int lastCellRow = -1;
+  uint16_t *line = rippleStrips[rippleStripIndex];
+  for (int y = 0; y < height; y++) {
+    int cellRow = (y + offsetY) / scale;
+    if (cellRow == lastCellRow) {
+      // Same cells as the line above, only possible when scaling up
+      memcpy(line, line - width, width * sizeof(uint16_t));
+    } else if (scale == 1) {
+      const uint16_t *cells = field + cellRow*xdim + offsetX;
+      for (int x = 0; x < width; x++) line[x] = rippleShade(cells[x], palette);
+      if (map) {
+        const uint16_t *walls = map->loss + cellRow*xdim + offsetX;
+        for (int x = 0; x < width; x++) {
+          if (walls[x] == 0xffff) line[x] = palette.land;
+        }
+      }
+    } else {
+      const uint16_t *cells = field + cellRow*xdim;
+      const uint16_t *walls = map ? map->loss + cellRow*xdim : NULL;
+      int x = 0;
+      int cell = offsetX / scale;
+      int repeat = scale - offsetX % scale;
+      while (x < width) {
+        uint16_t colour = (walls && walls[cell] == 0xffff) ? palette.land : rippleShade(cells[cell], palette);
+        cell++;
+        for (; repeat > 0 && x < width; repeat--) line[x++] = colour;
+        repeat = scale;
+      }
+    }
+    lastCellRow = cellRow;
+    line += width;
+    if (++rows == RIPPLE_STRIP_ROWS || y == height-1) {
+      ripplePushRect(tft, 0, y - rows + 1, width, rows);
+      line = rippleStrips[rippleStripIndex];
+      rows = 0;
+      lastCellRow = -1;
+    }
+  }
+#ifdef RIPPLE_DMA
+  tft.dmaWait();
+#endif
+  tft.endWrite();
+}
+
+// Position of the centre of pixel p in 1/256 cells, ((p + 0.5) / scale - 0.5), clamped to
+// the field so the outermost pixels repeat the edge cells rather than reading past them
+static inline int rippleSamplePos(int p, int scale, int cells) {
+  int pos = ((2*p + 1) << 7) / scale - 128;
+  if (pos < 0) return 0;
+  if (pos > (cells-1) << 8) return (cells-1) << 8;
+  return pos;
+}
+
+void rippleRenderSmooth(TFT_eSPI &tft, const uint16_t *field, int xdim, int ydim, const RipplePalette &palette,
+                        int scale, int offsetX, int offsetY) {
+  int width = xdim*scale - offsetX;
+  int height = ydim*scale - offsetY;
+  if (width > tft.width()) width = tft.width();
+  if (width > RIPPLE_MAX_WIDTH) width = RIPPLE_MAX_WIDTH;
+  if (height > tft.height()) height = tft.height();
+  if (width <= 0 || height <= 0 || scale < 1) return;
+
+  // The horizontal weights are the same on every line
+  int firstCell = rippleSamplePos(offsetX, scale, xdim) >> 8;
+  for (int x = 0; x < width; x++) {
+    int pos = rippleSamplePos(x + offsetX, scale, xdim);
+    rippleColumnCell[x] = (pos >> 8) - firstCell;
+    rippleColumnWeight[x] = pos & 0xff;
+  }
+  // The last pixel may sit exactly on the last cell with zero weight on the next one
+  int spanCells = rippleColumnCell[width-1] + 2;
+  if (firstCell + spanCells > xdim) spanCells = xdim - firstCell;
+
+  tft.startWrite();
+  int rows = 0;
+  uint16_t *line = rippleStrips[rippleStripIndex];
+  for (int y = 0; y < height; y++) {
+    int pos = rippleSamplePos(y + offsetY, scale, ydim);
+    uint32_t below = pos & 0xff;
+    uint32_t above = 256 - below;
+    const uint16_t *top = field + (pos >> 8)*xdim + firstCell;
+    const uint16_t *bottom = (below > 0) ? top + xdim : top;
+    for (int i = 0; i < spanCells; i++) rippleSpan[i] = (top[i]*above + bottom[i]*below) >> 8;
+    rippleSpan[spanCells] = rippleSpan[spanCells-1];
+
+    for (int x = 0; x < width; x++) {
+      const uint16_t *pair = rippleSpan + rippleColumnCell[x];
+      uint32_t right = rippleColumnWeight[x];
+      line[x] = rippleShade((pair[0]*(256 - right) + pair[1]*right) >> 8, palette);
+    }
+    line += width;
+    if (++rows == RIPPLE_STRIP_ROWS || y == height-1) {
+      ripplePushRect(tft, 0, y - rows + 1, width, rows);
+      line = rippleStrips[rippleStripIndex];
+      rows = 0;
+    }
+  }
+#ifdef RIPPLE_DMA
+  tft.dmaWait();
+#endif
+  tft.endWrite();
+}
+
+// Palette index for a height, moved up or down by the slope across its four neighbours
+static inline uint16_t rippleLitShade(uint16_t height, int left, int right, int up, int down,
+                                      const RipplePalette &palette) {
+  int level = (height >> (16 - RIPPLE_LUT_BITS)) + ((left - right + up - down) >> RIPPLE_HIGHLIGHT_SHIFT);
+  if (level < 0) level = 0;
+  if (level > RIPPLE_LUT_SIZE-1) level = RIPPLE_LUT_SIZE-1;
+  return palette.colours[level];
+}
+
+// Shades one row of the new field, rows and columns past the edge repeat the edge
+static void rippleShadeRow(const uint16_t *row, const uint16_t *up, const uint16_t *down, uint16_t *line,
+                           int xdim, int width, const RipplePalette &palette, bool highlight) {
+  if (!highlight) {
+    for (int x = 0; x < width; x++) line[x] = rippleShade(row[x], palette);
+    return;
+  }
+  int last = (width < xdim) ? width : xdim-1;
+  line[0] = rippleLitShade(row[0], row[0], row[1], up[0], down[0], palette);
+  for (int x = 1; x < last; x++) line[x] = rippleLitShade(row[x], row[x-1], row[x+1], up[x], down[x], palette);
+  if (last < width) line[last] = rippleLitShade(row[last], row[last-1], row[last], up[last], down[last], palette);
+}
+
+unsigned long rippleStepRender(TFT_eSPI &tft, const uint16_t *source, const uint16_t *prev, uint16_t *dest,
+                               int xdim, int ydim, int dampShift, RippleMode mode, const RipplePalette &palette,
+                               bool highlight) {
+  if (xdim < 3 || ydim < 3) return 0;
+  int width = xdim < tft.width() ? xdim : tft.width();
+  int height = ydim < tft.height() ? ydim : tft.height();
+  if (width > RIPPLE_MAX_WIDTH) width = RIPPLE_MAX_WIDTH;
+
+  unsigned long start = rippleMicros();
+  tft.startWrite();
+  int rows = 0;
+  uint16_t *line = rippleStrips[rippleStripIndex];
+  for (int j = 0; j < ydim; j++) {
+    // Row j+1 is computed first so the slope at row j can use it
+    if (j+1 < ydim-1) {
+      const uint16_t *mid = source + (j+1)*xdim;
+      uint16_t *out = dest + (j+1)*xdim;
+      const uint16_t *back = prev + (j+1)*xdim;
+      int tail = rippleRowVector(mid - xdim, mid, mid + xdim, back, out, 1, xdim-1, dampShift, mode);
+      rippleRowScalar(mid - xdim, mid, mid + xdim, back, out, tail, xdim-1, dampShift, mode);
+    }
+    if (j >= height) continue;
+    const uint16_t *row = dest + j*xdim;
+    rippleShadeRow(row, j > 0 ? row - xdim : row, j < ydim-1 ? row + xdim : row, line, xdim, width, palette,
+                   highlight);
+    line += width;
+    if (++rows == RIPPLE_STRIP_ROWS || j == height-1) {
+      ripplePushRect(tft, 0, j - rows + 1, width, rows);
+      line = rippleStrips[rippleStripIndex];
+      rows = 0;
+    }
+  }
+#ifdef RIPPLE_DMA
+  tft.dmaWait();
+#endif
+  tft.endWrite();
+  unsigned long cells = (unsigned long)(xdim-2) * (ydim-2);
+  rippleStats.micros += rippleMicros() - start;
+  rippleStats.cells += cells;
+  rippleStats.steps++;
+  return cells;
+}
+
+int rippleRenderTiles(TFT_eSPI &tft, const uint16_t *field, int xdim, int ydim, const RipplePalette &palette,
+                      const RippleActivity &live, uint8_t *shadow, RippleActivity &drawn) {
+  int width = xdim < tft.width() ? xdim : tft.width();
+  int height = ydim < tft.height() ? ydim : tft.height();
+  int tilesX = (xdim + RIPPLE_TILE-1) / RIPPLE_TILE;
+  if (!rippleTilesFit(xdim, ydim)) {
+    rippleRender(tft, field, xdim, ydim, palette);
+    return ((width + RIPPLE_TILE-1) / RIPPLE_TILE) * ((height + RIPPLE_TILE-1) / RIPPLE_TILE);
+  }
+  int pushed = 0;
+  tft.startWrite();
+  for (int y0 = 0; y0 < height; y0 += RIPPLE_TILE) {
+    int rows = (height - y0 < RIPPLE_TILE) ? height - y0 : RIPPLE_TILE;
+    for (int x0 = 0; x0 < width; x0 += RIPPLE_TILE) {
+      int cols = (width - x0 < RIPPLE_TILE) ? width - x0 : RIPPLE_TILE;
+      int tile = (y0 / RIPPLE_TILE) * tilesX + x0 / RIPPLE_TILE;
+      if (!rippleTileLive(live, tile) && !rippleTileLive(drawn, tile)) continue;
+
+      bool changed = false;
+      uint8_t any = 0;
+      for (int j = y0; j < y0 + rows; j++) {
+        const uint16_t *cells = field + j*xdim;
+        uint8_t *levels = shadow + j*xdim;
+        for (int i = x0; i < x0 + cols; i++) {
+          uint8_t level = cells[i] >> (16 - RIPPLE_LUT_BITS);
+          changed |= (level != levels[i]);
+          levels[i] = level;
+          any |= level;
+        }
+      }
+      rippleSetTile(drawn, tile, any != 0);
+      if (!changed) continue;
+
+      uint16_t *strip = rippleStrips[rippleStripIndex];
+      for (int j = 0; j < rows; j++) {
+        const uint8_t *levels = shadow + (y0+j)*xdim + x0;
+        for (int i = 0; i < cols; i++) strip[j*cols + i] = palette.colours[levels[i]];
+      }
+      ripplePushRect(tft, x0, y0, cols, rows);
+      pushed++;
+    }
+  }
+#ifdef RIPPLE_DMA
+  tft.dmaWait();
+#endif
+  tft.endWrite();
+  return pushed;
+}
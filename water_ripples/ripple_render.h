@@ -0,0 +1,76 @@
+// Ripple renderer
+// Converts heights into RGB565 strips and pushes each strip as a single image
+#ifndef RIPPLE_RENDER_H
+#define RIPPLE_RENDER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <TFT_eSPI.h>
+#include "ripple.h"
+#include "ripple_map.h"
+
+#define RIPPLE_STRIP_ROWS 10
+#define RIPPLE_MAX_WIDTH 320
+#define RIPPLE_LUT_BITS 8
+#define RIPPLE_LUT_SIZE (1 << RIPPLE_LUT_BITS)
+// Palette steps added per unit of slope when highlighting, as a right shift of the slope
+#define RIPPLE_HIGHLIGHT_SHIFT 8
+
+// Height-to-colour lookup table indexed by the top RIPPLE_LUT_BITS of the height.
+// Colours are stored byte swapped, ready to push. Any number of palettes can be built
+// at startup and swapped between frames by passing a different one to rippleRender().
+// land is the colour of wall cells when a RippleMap is drawn, also byte swapped.
+struct RipplePalette {
+  uint16_t colours[RIPPLE_LUT_SIZE];
+  uint16_t land;
+};
+#define RIPPLE_LAND_COLOUR 0xc590 // sand, what the palette builders give walls
+
+// Spreads numShades colours evenly over the height range, like the old map() to a shade index,
+// with 0xffff landing on the last shade
+void rippleBuildPalette(RipplePalette &palette, const int *shades, int numShades);
+
+// Built-in alternatives to a sketch's own shade table
+void rippleLavaPalette(RipplePalette &palette);
+void rippleGreyPalette(RipplePalette &palette);
+
+// Build with RIPPLE_DMA defined to double buffer the strips and push them with DMA while the
+// next strip is filled. TFT_eSPI only has DMA for SPI panels, the T-Display S3 parallel bus
+// uses pushImage.
+// #define RIPPLE_DMA
+
+// Must run after tft.init()
+void rippleRenderBegin(TFT_eSPI &tft);
+
+// Draws every cell as a scale x scale block. (offsetX, offsetY) is the pixel of the
+// scaled field that lands on the top-left of the screen, anything past the screen is cropped.
+// With a map, its walls are drawn in the palette's land colour instead of as still water.
+void rippleRender(TFT_eSPI &tft, const uint16_t *field, int xdim, int ydim, const RipplePalette &palette,
+                  int scale = 1, int offsetX = 0, int offsetY = 0, const RippleMap *map = NULL);
+
+// Same framing as rippleRender(), but each pixel is a bilinear blend of the four nearest cells
+// instead of a flat block, so a field simulated at 1/2 or 1/4 of the screen resolution still
+// fills the screen without visible blocks. Weights are 8-bit fixed point and the blend is
+// done straight into the strip buffer alongside the colour lookup.
+void rippleRenderSmooth(TFT_eSPI &tft, const uint16_t *field, int xdim, int ydim, const RipplePalette &palette,
+                        int scale, int offsetX = 0, int offsetY = 0);
+
+// Fused step and render at scale 1: the same update as rippleStepFrom(), but each row is
+// shaded into the strip buffer as soon as the row below it has been computed, while both are
+// still in cache, so dest is never read back by a separate render pass. With highlight set
+// the shade is offset by the local slope, lighting faces that tilt towards the top-left.
+// Counts towards rippleStats like rippleStepFrom(). Returns the number of cells updated.
+unsigned long rippleStepRender(TFT_eSPI &tft, const uint16_t *source, const uint16_t *prev, uint16_t *dest,
+                               int xdim, int ydim, int dampShift, RippleMode mode, const RipplePalette &palette,
+                               bool highlight = false);
+
+// Dirty-tile rendering at scale 1. shadow holds the palette index last drawn for every cell
+// (xdim*ydim bytes) and drawn marks the tiles that were not blank when last drawn.
+// Tiles blank in both live and drawn are skipped without reading the field, the rest are
+// pushed only if some cell's palette index changed. Returns the number of tiles pushed.
+// The shadow knows nothing about palettes, so redraw in full after swapping palettes.
+// A grid too big for the tile bitmap is drawn in full by rippleRender() every time.
+int rippleRenderTiles(TFT_eSPI &tft, const uint16_t *field, int xdim, int ydim, const RipplePalette &palette,
+                      const RippleActivity &live, uint8_t *shadow, RippleActivity &drawn);
+
+#endif
@@ -3,16 +3,22 @@
 // 24 September 2025
 #include <Arduino.h>
 #include <TFT_eSPI.h>
+#include "ripple.h"
+#include "ripple_render.h"
+#include "ripple_field.h"
 
 #define LEFT 0
 #define RIGHT 14
 
 // simulation parameters
 #define DELAY_MILLIS 50
-#define XDIM 160
-#define YDIM 85
-#define L 2
+typedef RippleClassic Water; // grid size, dampening and scale
+#define XDIM Water::XDIM
+#define YDIM Water::YDIM
+#define L Water::SCALE
 #define NUM_SHADES 15
+#define OVERFLOW_MODE RIPPLE_SATURATE
+#define REPORT_MILLIS 1000
 
 TFT_eSPI tft = TFT_eSPI(); // 170 x 320 pixels
 
@@ -40,6 +46,10 @@ int shades[] = {
   0xffff
 };
 
+// Colour tables built once in setup(), renderWater() draws with whichever palette points to
+RipplePalette ocean, lava, grey;
+const RipplePalette *palette = &ocean;
+
 void renderWater(uint16_t *dest);
 void processWater(uint16_t *source, uint16_t *dest);
 
@@ -48,11 +58,19 @@ void setup()
   pinMode(LEFT, INPUT_PULLUP);
   pinMode(RIGHT, INPUT_PULLUP);
 
+  Serial.begin(115200);
+  // Check the vector kernel against the scalar reference before trusting it
+  if (rippleSelfTest(millis() + 1, 64) > 0) Serial.println("ripple kernel mismatch");
+
   tft.init();
   tft.setRotation(3);
   tft.fillScreen(TFT_BLACK);
   tft.setTextSize(1);
   tft.setTextColor(TFT_WHITE, TFT_BLACK);
+  rippleRenderBegin(tft);
+  rippleBuildPalette(ocean, shades, NUM_SHADES);
+  rippleLavaPalette(lava);
+  rippleGreyPalette(grey);
 
   for (int i = 1; i < XDIM-1; i++) {
     for (int j = 1; j < YDIM-1; j++) {
@@ -68,6 +86,7 @@ void setup()
 void loop()
 {
   static unsigned long lastUpdateTime = millis();
+  static unsigned long lastReportTime = millis();
   static int prevLeft = 0, prevRight = 0;
   static int currLeft = 0, currRight = 0;
   static uint16_t *p1 = buffer1;
@@ -102,35 +121,26 @@ void loop()
     p2 = temp;
     lastUpdateTime = millis();
   }
+  if (millis() - lastReportTime > REPORT_MILLIS) {
+    // Simulation throughput, and the frame rate the stencil alone could sustain
+    float cellsPerSecond = rippleCellsPerSecond();
+    Serial.print(cellsPerSecond / 1000);
+    Serial.print(" kcells/s, ");
+    Serial.print(cellsPerSecond / ((XDIM-2)*(YDIM-2)));
+    Serial.println(" steps/s");
+    rippleResetStats();
+    lastReportTime = millis();
+  }
   prevLeft = currLeft;
   prevRight = currRight;
 }
 
 void renderWater(uint16_t *dest) {
-  for (int i = 0; i < XDIM; i++) {
-    for (int j = 0; j < YDIM; j++) {
-      int colorVal = dest[j*XDIM + i];
-      int shadeIndex = map(colorVal, 0, 0xffff, 0, NUM_SHADES);
-      tft.fillRect(i*L, j*L, L, L, shades[shadeIndex]);
-    }
-  }
+  rippleRender(tft, dest, XDIM, YDIM, *palette, L);
 }
 
 void processWater(uint16_t *source, uint16_t *dest) {
-  for (int i = 1; i < XDIM-1; i++) {
-    for (int j = 1; j < YDIM-1; j++) {
-      uint16_t smoothed =
-        source[((j-1)*XDIM + i)]
-        + source[((j+1)*XDIM + i)]
-        + source[(j*XDIM + i-1)]
-        + source[(j*XDIM + i+1)] >> 1;
-      if (smoothed > dest[j*XDIM + i]) dest[j*XDIM + i] = smoothed - dest[j*XDIM + i];
-      else dest[j*XDIM + i] = 0;
-      uint16_t dampening = dest[j*XDIM + i] >> 11;
-      if (dampening < dest[j*XDIM + i]) dest[j*XDIM + i] -= dampening;
-      else dest[j*XDIM + i] = 0;
-    }
-  }
+  Water::step<OVERFLOW_MODE>(source, dest);
   if (sourceOn) {
     sourceRow += random(-1, 2);
     sourceCol += random(-1, 2);
@@ -3,28 +3,78 @@
 // 24 September 2025
 #include <Arduino.h>
 #include <TFT_eSPI.h>
+#include "ripple.h"
+#include "ripple_render.h"
+#include "ripple_field.h"
+#include "ripple_governor.h"
 
 #define LEFT 0
 #define RIGHT 14
 
 // simulation parameters
 #define DELAY_MILLIS 100
-#define XDIM 320
-#define YDIM 170
+typedef RippleFull Water; // grid size, dampening and scale
+#define XDIM Water::XDIM
+#define YDIM Water::YDIM
 #define NUM_SHADES 15
+#define OVERFLOW_MODE RIPPLE_SATURATE
+#define NUM_WORKERS 2 // one band per core
+#define PIPELINE true // simulate on core 0 while the loop task on core 1 renders
+#define DIRTY_TILES true // only simulate and redraw tiles where the water is moving
+// With PIPELINE and DIRTY_TILES off, step and draw each frame in a single pass. The source
+// and raindrops then show up one frame later, as they are added after the frame is drawn.
+#define FUSED false
+#define HIGHLIGHT true // light the slopes in the fused pass
+// Holds DELAY_MILLIS per frame by drawing only some of the frames when drawing falls behind,
+// and shows the frame rate and stage costs at the top of the screen
+#define GOVERNOR true
+#define REPORT_MILLIS 1000
 
 TFT_eSPI tft = TFT_eSPI(); // 170 x 320 pixels
 
 const bool randomStart = false;
 
-bool sourceOn = false;
-bool rainfallOn = false;
+// What loop() asks of a frame. Each frame slot carries its own copy, written by loop() before
+// the slot is handed to the simulation, so with PIPELINE the two cores share nothing else:
+// the source's position, the timers and every random() call belong to the simulation.
+struct FrameInput {
+  bool sourceOn, rainfallOn;
+  bool sourceStarted, rainfallStarted; // switched on since the last frame was handed over
+  bool splashing;
+};
+FrameInput pendingInput;  // loop()'s buttons so far
+FrameInput frameInputs[3];
+// Simulation side only
 unsigned long rainTimer = DELAY_MILLIS;
 unsigned long directionTimer = DELAY_MILLIS;
 int sourceRow = YDIM/2;
 int sourceCol = XDIM/2;
 uint16_t buffer1[XDIM * YDIM];
 uint16_t buffer2[XDIM * YDIM];
+// Frame n is simulated into frames[n%3] from the two frames before it, so the frame
+// being rendered is never written. The third buffer is allocated in setup().
+uint16_t *frames[3] = {buffer1, buffer2, NULL};
+// Tiles of each frame that may be non-zero, and what the screen currently shows
+RippleActivity activity[3];
+uint8_t *shadow;
+RippleActivity drawn;
+
+// Per-stage cost in microseconds and the stencil's counters, summed between reports. Only the
+// renderer's side touches these: the simulation owns rippleStats and leaves each frame's
+// costs in its slot, which the semaphore carries across with the frame.
+unsigned long simMicros = 0, renderMicros = 0;
+unsigned long simFrames = 0, renderFrames = 0;
+unsigned long tilesPushed = 0;
+RippleStats simStats = {0, 0, 0, 0};
+unsigned long frameSimMicros[3]; // simulation cost of the frame in each slot
+RippleStats frameStats[3];       // and what rippleStats gained meanwhile
+RippleGovernor governor;
+uint32_t splashSeed = 1;
+
+#if PIPELINE
+SemaphoreHandle_t framesFree;
+SemaphoreHandle_t framesReady;
+#endif
 int shades[] = {
   0x0007,
   0x0009,
@@ -43,19 +93,64 @@ int shades[] = {
   0xffff
 };
 
+// Colour tables built once in setup(), renderWater() draws with whichever palette points to
+RipplePalette ocean, lava, grey;
+const RipplePalette *palette = &ocean;
+
 void renderWater(uint16_t *dest);
-void processWater(uint16_t *source, uint16_t *dest);
+void processWater(int n, bool fromRest);
+void simulateFrame(int n);
+void renderFrame(int n);
+void presentFrame(int n);
+void handOver(int n);
+void simulateTask(void *arg);
+
+#if FUSED && (PIPELINE || DIRTY_TILES)
+#error "FUSED needs PIPELINE and DIRTY_TILES turned off"
+#endif
 
 void setup()
 {
   pinMode(LEFT, INPUT_PULLUP);
   pinMode(RIGHT, INPUT_PULLUP);
 
+  Serial.begin(115200);
+  // Check the vector kernel against the scalar reference before trusting it
+  if (rippleSelfTest(millis() + 1, 64) > 0) Serial.println("ripple kernel mismatch");
+#if defined(RIPPLE_PIE)
+  // Time the PIE loop against the generic kernel on the still empty field. Every step costs
+  // the same whatever the heights, and an empty field stays empty.
+  float rates[2];
+  bool pie = rippleUsePie;
+  for (int k = 0; k < 2; k++) {
+    rippleUsePie = pie && k == 1;
+    unsigned long start = micros();
+    for (int s = 0; s < 20; s++) rippleStep(buffer1, buffer2, XDIM, YDIM, Water::DAMPENING, OVERFLOW_MODE);
+    rates[k] = 20.0f * (XDIM-2) * (YDIM-2) * 1000 / max(1UL, micros() - start);
+  }
+  rippleUsePie = pie;
+  rippleResetStats();
+  Serial.print("generic kernel ");
+  Serial.print(rates[0]);
+  Serial.print(" kcells/s, PIE ");
+  Serial.print(rates[1]);
+  Serial.println(" kcells/s");
+#endif
+  // The third frame goes on the heap, which falls back to PSRAM when internal RAM is short
+  frames[2] = (uint16_t *)calloc(XDIM * YDIM, sizeof(uint16_t));
+  shadow = (uint8_t *)calloc(XDIM * YDIM, sizeof(uint8_t));
+  for (int k = 0; k < 3; k++) rippleMarkAll(activity[k]);
+  rippleMarkAll(drawn);
+
   tft.init();
   tft.setRotation(3);
   tft.fillScreen(TFT_BLACK);
   tft.setTextSize(1);
   tft.setTextColor(TFT_WHITE, TFT_BLACK);
+  rippleRenderBegin(tft);
+  rippleBuildPalette(ocean, shades, NUM_SHADES);
+  rippleLavaPalette(lava);
+  rippleGreyPalette(grey);
 
   if (randomStart) {
     for (int i = 1; i < XDIM-1; i++) {
@@ -67,84 +162,186 @@ void setup()
     }
   }
   renderWater(buffer2);
+
+  splashSeed = millis() + 1;
+  // The fused pass draws while it simulates, so it cannot skip drawing
+  rippleGovernorBegin(governor, 1000 / DELAY_MILLIS, 1, (GOVERNOR && !FUSED) ? 4 : 1, PIPELINE);
+#if PIPELINE
+  // Simulation may run up to three frames ahead of the renderer (see simulateFrame())
+  framesFree = xSemaphoreCreateCounting(3, 3);
+  framesReady = xSemaphoreCreateCounting(3, 0);
+  xTaskCreatePinnedToCore(simulateTask, "simulate", 4096, NULL, 1, NULL, 0);
+#else
+  rippleParallelBegin(NUM_WORKERS);
+#endif
 }
 
 void loop()
 {
   static unsigned long lastUpdateTime = millis();
+  static unsigned long lastReportTime = millis();
   static int prevLeft = 0, prevRight = 0;
   static int currLeft = 0, currRight = 0;
-  static uint16_t *p1 = buffer1;
-  static uint16_t *p2 = buffer2;
-  static uint16_t *temp;
+  static int frame = 2;
   currLeft = !digitalRead(LEFT);
   currRight = !digitalRead(RIGHT);
 
   if (prevLeft && !currLeft) {
-    sourceOn = !sourceOn;
-    if (sourceOn) {
-      sourceRow = random(10, YDIM-10);
-      sourceCol = random(10, XDIM-10);
-      directionTimer = 0;
-    }
+    pendingInput.sourceOn = !pendingInput.sourceOn;
+    pendingInput.sourceStarted = pendingInput.sourceOn;
   } else if (prevRight && !currRight) {
-    rainfallOn = !rainfallOn;
-    if (rainfallOn) rainTimer = 0;
+    pendingInput.rainfallOn = !pendingInput.rainfallOn;
+    pendingInput.rainfallStarted = pendingInput.rainfallOn;
   }
 
+  pendingInput.splashing = currLeft && currRight;
+
   if (millis() - lastUpdateTime > DELAY_MILLIS) {
-    processWater(p1, p2);
-    if (currLeft && currRight) {
-      for (int i = 1; i < XDIM-1; i++) {
-        for (int j = 1; j < YDIM-1; j++) {
-          if (p2[j*XDIM + i] > 0x2000 && p2[j*XDIM + i] < 0x5000)
-            p2[j*XDIM + i] += random(0,0xa000);
-          p1[j*XDIM + i] = p2[j*XDIM + i];
-        }
-      }
-    }
-    renderWater(p2);
-    temp = p1;
-    p1 = p2;
-    p2 = temp;
     lastUpdateTime = millis();
+#if PIPELINE
+    xSemaphoreTake(framesReady, portMAX_DELAY);
+    presentFrame(frame);
+    // The slot just presented is simulated into next as frame + 3
+    handOver(frame + 3);
+    frame++;
+    xSemaphoreGive(framesFree);
+#else
+    handOver(frame);
+    simulateFrame(frame);
+    presentFrame(frame++);
+#endif
+  }
+  if (millis() - lastReportTime > REPORT_MILLIS) {
+    // Simulation throughput, and the frame rate the stencil alone could sustain
+    float cellsPerSecond = simStats.micros > 0 ? simStats.cells * 1e6f / simStats.micros : 0;
+    Serial.print(cellsPerSecond / 1000);
+    Serial.print(" kcells/s, ");
+    Serial.print(cellsPerSecond / ((XDIM-2)*(YDIM-2)));
+    Serial.print(" steps/s, ");
+    Serial.print(100.0 * simStats.cells / max(1UL, simStats.steps * (XDIM-2) * (YDIM-2)));
+    Serial.println("% of cells simulated");
+    // Per-stage cost: with PIPELINE the frame time is the larger of the two, otherwise their sum
+    if (simFrames > 0 && renderFrames > 0) {
+      Serial.print("simulate ");
+      Serial.print(simMicros / simFrames);
+      Serial.print(" us, render ");
+      Serial.print(renderMicros / renderFrames);
+      Serial.print(" us, ");
+      Serial.print(tilesPushed / renderFrames);
+      Serial.print(" tiles pushed, ");
+      Serial.print(renderFrames * 1000.0 / (millis() - lastReportTime));
+      Serial.println(" fps");
+    }
+    simMicros = renderMicros = 0;
+    simFrames = renderFrames = 0;
+    tilesPushed = 0;
+    simStats = RippleStats();
+    lastReportTime = millis();
   }
   prevLeft = currLeft;
   prevRight = currRight;
 }
 
-void renderWater(uint16_t *dest) {
-  for (int i = 0; i < XDIM; i++) {
-    for (int j = 0; j < YDIM; j++) {
-      int colorVal = dest[j*XDIM + i];
-      int shadeIndex = map(colorVal, 0, 0xffff, 0, NUM_SHADES);
-      tft.drawPixel(i, j, shades[shadeIndex]);
-      //tft.fillRect(i*2, j*2, 2, 2, shades[shadeIndex]);
-    }
+// Gives frame n the buttons pressed so far. With PIPELINE the slot must not be handed to the
+// simulation until this returns, the semaphore then carries the input across.
+void handOver(int n) {
+  frameInputs[n % 3] = pendingInput;
+  pendingInput.sourceStarted = pendingInput.rainfallStarted = false;
+}
+
+#if PIPELINE
+// Core 0: produces frames 2, 3, 4, ... Frame n overwrites frame n-3, so it must wait
+// until the renderer has released that frame (framesFree starts with three tokens,
+// covering frames 2 to 4, which only overwrite the initial buffers).
+void simulateTask(void *arg) {
+  for (int n = 2; ; n++) {
+    xSemaphoreTake(framesFree, portMAX_DELAY);
+    simulateFrame(n);
+    xSemaphoreGive(framesReady);
   }
 }
+#endif
+
+void simulateFrame(int n) {
+  static bool atRest = false;
+  uint16_t *dest = frames[n % 3];
+  RippleStats before = rippleStats;
+  unsigned long start = micros();
+  // After a splash the next step starts from rest, as if the previous frame equalled this one
+  processWater(n, atRest);
+  atRest = frameInputs[n % 3].splashing;
+  // Only cells that are already non-zero change, so the tile bitmap stays valid
+  if (atRest) rippleSplash(dest, XDIM, YDIM, splashSeed);
+  frameSimMicros[n % 3] = micros() - start;
+  RippleStats &stats = frameStats[n % 3];
+  stats.cells = rippleStats.cells - before.cells;
+  stats.micros = rippleStats.micros - before.micros;
+  stats.steps = rippleStats.steps - before.steps;
+  stats.steals = rippleStats.steals - before.steals;
+}
+
+void renderFrame(int n) {
+  unsigned long start = micros();
+#if FUSED
+  // Already drawn by simulateFrame()
+#elif DIRTY_TILES
+  tilesPushed += rippleRenderTiles(tft, frames[n % 3], XDIM, YDIM, *palette, activity[n % 3], shadow, drawn);
+#else
+  renderWater(frames[n % 3]);
+#endif
+  renderMicros += micros() - start;
+  renderFrames++;
+}
 
-void processWater(uint16_t *source, uint16_t *dest) {
+// Draws frame n unless the governor skips it, then lets the governor weigh the frame's cost
+// and adds its simulation costs to the report
+void presentFrame(int n) {
+  const RippleStats &stats = frameStats[n % 3];
+  simMicros += frameSimMicros[n % 3];
+  simFrames++;
+  simStats.cells += stats.cells;
+  simStats.micros += stats.micros;
+  simStats.steps += stats.steps;
+  simStats.steals += stats.steals;
+  bool shown = rippleGovernorDraws(governor, n);
+  unsigned long start = micros();
+  if (shown) {
+    renderFrame(n);
+    rippleGovernorDraw(tft, governor);
+  }
+  rippleGovernorFrame(governor, frameSimMicros[n % 3], micros() - start, shown);
+}
+
+void renderWater(uint16_t *dest) {
+  rippleRender(tft, dest, XDIM, YDIM, *palette);
+}
+
+// Steps frame n from the two frames before it (or from rest), then adds the source and raindrops
+void processWater(int n, bool fromRest) {
   static unsigned long lastRainfall = millis();
   static unsigned long lastDirection = millis();
-  for (int i = 1; i < XDIM-1; i++) {
-    for (int j = 1; j < YDIM-1; j++) {
-      uint16_t smoothed =
-        source[((j-1)*XDIM + i)]
-        + source[((j+1)*XDIM + i)]
-        + source[(j*XDIM + i-1)]
-        + source[(j*XDIM + i+1)] >> 1;
-      if (smoothed > dest[j*XDIM + i]) dest[j*XDIM + i] = smoothed - dest[j*XDIM + i];
-      else dest[j*XDIM + i] = 0;
-      uint16_t dampening = dest[j*XDIM + i] >> 9;
-      if (dampening < dest[j*XDIM + i]) dest[j*XDIM + i] -= dampening;
-      else dest[j*XDIM + i] = 0;
-    }
+  int s = (n+2) % 3;
+  int p = fromRest ? s : (n+1) % 3;
+  uint16_t *dest = frames[n % 3];
+  RippleActivity &live = activity[n % 3];
+  const FrameInput &input = frameInputs[n % 3];
+  if (input.sourceStarted) {
+    sourceRow = random(10, YDIM-10);
+    sourceCol = random(10, XDIM-10);
+    directionTimer = 0;
   }
+  if (input.rainfallStarted) rainTimer = 0;
+#if FUSED
+  rippleStepRender(tft, frames[s], frames[p], dest, XDIM, YDIM, Water::DAMPENING, OVERFLOW_MODE, *palette, HIGHLIGHT);
+#elif DIRTY_TILES
+  rippleStepTiled(frames[s], frames[p], dest, XDIM, YDIM, Water::DAMPENING, OVERFLOW_MODE, activity[s], activity[p], live);
+#else
+  rippleParallelStep(frames[s], frames[p], dest, XDIM, YDIM, Water::DAMPENING, OVERFLOW_MODE);
+#endif
   // Randomly moving bullet
   static int offsetX = 2*random(-3, 4);
   static int offsetY = 2*random(-3, 4);
-  if (sourceOn) {
+  if (input.sourceOn) {
     if (millis() - lastDirection > directionTimer) {
       offsetX = 2*random(-3, 4);
       offsetY = 2*random(-3, 4);
@@ -168,9 +365,10 @@ void processWater(uint16_t *source, uint16_t *dest) {
       directionTimer = 0;
     }
     dest[sourceRow*XDIM + sourceCol] = 0xffff;
+    rippleMarkCell(live, XDIM, sourceCol, sourceRow);
   }
   // Raindrops
-  if (rainfallOn && millis() - lastRainfall > rainTimer) {
+  if (input.rainfallOn && millis() - lastRainfall > rainTimer) {
     int repeats = random(-3, 4);
     if (repeats < 1) repeats = 1;
     rainTimer = random(20*repeats*DELAY_MILLIS, 50*repeats*DELAY_MILLIS);
@@ -187,6 +385,7 @@ void processWater(uint16_t *source, uint16_t *dest) {
             j += random(-1, 2);
           }
           dest[j*XDIM + i] = 0xffff;
+          rippleMarkCell(live, XDIM, i, j);
         }
       }
       repeats--;
@@ -3,15 +3,39 @@
 // 24 September 2025
 #include <Arduino.h>
 #include <TFT_eSPI.h>
+#include "ripple.h"
+#include "ripple_render.h"
+#include "ripple_field.h"
+#include "ripple_governor.h"
 
 #define LEFT 0
 #define RIGHT 14
 
 // simulation parameters
 #define DELAY_MILLIS 50
-#define XDIM 180
-#define YDIM 95
+// Cells per pixel along each axis: 2 simulates 180x95 for the 320x170 screen, 4 simulates
+// 90x47 at a quarter of that cost, 1 simulates every pixel. SMOOTH blends neighbouring cells
+// when drawing so the lower resolutions do not look blocky.
+#define RESOLUTION 2
+#define SMOOTH true
+typedef RippleField<360 / RESOLUTION, 190 / RESOLUTION, 13, RESOLUTION> Water; // RippleMini at 2
+#define BORDER (5 * RESOLUTION / 2) // pixels cropped off the top and left, hiding the fixed edge
+// Holds DELAY_MILLIS per frame by falling back to a grid with half the resolution, or by drawing
+// only some of the frames, and shows the frame rate and stage costs at the top of the screen
+#define GOVERNOR true
+#define COARSE_XDIM (180 / RESOLUTION)
+#define COARSE_YDIM (95 / RESOLUTION)
+typedef RippleField<COARSE_XDIM, COARSE_YDIM, 13, 2 * RESOLUTION> CoarseWater; // RippleQuarter at 2
+#define XDIM Water::XDIM
+#define YDIM Water::YDIM
 #define NUM_SHADES 16
+#define OVERFLOW_MODE RIPPLE_SATURATE
+// Simulation steps per frame, kept odd so the newest step always lands in dest. Above one
+// the steps are advanced together in a single temporally blocked sweep, which is no faster
+// than separate steps while the fields sit in internal RAM (see rippleStepBlocked()).
+#define STEPS_PER_FRAME 1
+#define STRIP_WIDTH XDIM
+#define REPORT_MILLIS 1000
 
 TFT_eSPI tft = TFT_eSPI(); // 170 x 320 pixels
 
@@ -25,6 +49,14 @@ int sourceRow = YDIM/2;
 int sourceCol = XDIM/2;
 uint16_t buffer1[XDIM * YDIM];
 uint16_t buffer2[XDIM * YDIM];
+// Grid in use, which is Water or CoarseWater
+int xdim = XDIM;
+int ydim = YDIM;
+int scale = Water::SCALE;
+int border = BORDER;
+uint16_t *scratch; // resampling space, allocated in setup()
+RippleGovernor governor;
+uint32_t splashSeed = 1;
 int shades[] = {
   0x0008,
   0x0009,
@@ -44,19 +76,32 @@ int shades[] = {
   0xffff
 };
 
+// Colour tables built once in setup(), renderWater() draws with whichever palette points to
+RipplePalette ocean, lava, grey;
+const RipplePalette *palette = &ocean;
+
 void renderWater(uint16_t *dest);
 void processWater(uint16_t *source, uint16_t *dest);
+void setLevel(int level, uint16_t *p1, uint16_t *p2);
 
 void setup()
 {
   pinMode(LEFT, INPUT_PULLUP);
   pinMode(RIGHT, INPUT_PULLUP);
 
+  Serial.begin(115200);
+  // Check the vector kernel against the scalar reference before trusting it
+  if (rippleSelfTest(millis() + 1, 64) > 0) Serial.println("ripple kernel mismatch");
+
   tft.init();
   tft.setRotation(3);
   tft.fillScreen(TFT_BLACK);
   tft.setTextSize(1);
   tft.setTextColor(TFT_WHITE, TFT_BLACK);
+  rippleRenderBegin(tft);
+  rippleBuildPalette(ocean, shades, NUM_SHADES);
+  rippleLavaPalette(lava);
+  rippleGreyPalette(grey);
 
   if (randomStart) {
     for (int i = 1; i < XDIM-1; i++) {
@@ -68,24 +113,34 @@ void setup()
     }
   }
   renderWater(buffer2);
+
+  scratch = (uint16_t *)malloc(XDIM * YDIM * sizeof(uint16_t));
+  splashSeed = millis() + 1;
+#if GOVERNOR
+  rippleGovernorBegin(governor, 1000 / DELAY_MILLIS, 2, 4);
+#else
+  rippleGovernorBegin(governor, 1000 / DELAY_MILLIS, 1, 1);
+#endif
 }
 
 void loop()
 {
   static unsigned long lastUpdateTime = millis();
+  static unsigned long lastReportTime = millis();
   static int prevLeft = 0, prevRight = 0;
   static int currLeft = 0, currRight = 0;
   static uint16_t *p1 = buffer1;
   static uint16_t *p2 = buffer2;
   static uint16_t *temp;
+  static unsigned long frame = 0;
   currLeft = !digitalRead(LEFT);
   currRight = !digitalRead(RIGHT);
 
   if (prevLeft && !currLeft) {
     sourceOn = !sourceOn;
     if (sourceOn) {
-      sourceRow = random(10, YDIM-10);
-      sourceCol = random(10, XDIM-10);
+      sourceRow = random(10, ydim-10);
+      sourceCol = random(10, xdim-10);
       directionTimer = 0;
     }
   } else if (prevRight && !currRight) {
@@ -94,54 +149,58 @@ void loop()
   }
 
   if (millis() - lastUpdateTime > DELAY_MILLIS) {
+    unsigned long start = micros();
     processWater(p1, p2);
     if (currLeft && currRight) {
-      for (int i = 1; i < XDIM-1; i++) {
-        for (int j = 1; j < YDIM-1; j++) {
-          if (p2[j*XDIM + i] > 0x2000 && p2[j*XDIM + i] < 0x5000)
-            p2[j*XDIM + i] += random(0,0xa000);
-          p1[j*XDIM + i] = p2[j*XDIM + i];
-        }
-      }
+      rippleSplash(p2, xdim, ydim, splashSeed);
+      memcpy(p1, p2, xdim * ydim * sizeof(uint16_t));
+    }
+    unsigned long simulated = micros();
+    bool drawn = rippleGovernorDraws(governor, frame++);
+    if (drawn) {
+      renderWater(p2);
+      rippleGovernorDraw(tft, governor);
     }
-    renderWater(p2);
+    unsigned long rendered = micros();
     temp = p1;
     p1 = p2;
     p2 = temp;
+    if (rippleGovernorFrame(governor, simulated - start, rendered - simulated, drawn)) {
+      setLevel(governor.level, p1, p2);
+    }
     lastUpdateTime = millis();
   }
+  if (millis() - lastReportTime > REPORT_MILLIS) {
+    // Simulation throughput, and the frame rate the stencil alone could sustain
+    float cellsPerSecond = rippleCellsPerSecond();
+    Serial.print(cellsPerSecond / 1000);
+    Serial.print(" kcells/s, ");
+    Serial.print(cellsPerSecond / ((xdim-2)*(ydim-2)));
+    Serial.println(" steps/s");
+    rippleResetStats();
+    lastReportTime = millis();
+  }
   prevLeft = currLeft;
   prevRight = currRight;
 }
 
 void renderWater(uint16_t *dest) {
-  for (int i = 0; i < XDIM; i++) {
-    for (int j = 0; j < YDIM; j++) {
-      int colorVal = dest[j*XDIM + i];
-      int shadeIndex = map(colorVal, 0, 0xffff, 0, NUM_SHADES);
-      //tft.drawPixel(i-5, j-5, shades[shadeIndex]);
-      tft.fillRect(i*2-5, j*2-5, 2, 2, shades[shadeIndex]);
-    }
-  }
+#if SMOOTH
+  rippleRenderSmooth(tft, dest, xdim, ydim, *palette, scale, border, border);
+#else
+  rippleRender(tft, dest, xdim, ydim, *palette, scale, border, border);
+#endif
 }
 
 void processWater(uint16_t *source, uint16_t *dest) {
   static unsigned long lastRainfall = millis();
   static unsigned long lastDirection = millis();
-  for (int i = 1; i < XDIM-1; i++) {
-    for (int j = 1; j < YDIM-1; j++) {
-      uint16_t smoothed =
-        source[((j-1)*XDIM + i)]
-        + source[((j+1)*XDIM + i)]
-        + source[(j*XDIM + i-1)]
-        + source[(j*XDIM + i+1)] >> 1;
-      if (smoothed > dest[j*XDIM + i]) dest[j*XDIM + i] = smoothed - dest[j*XDIM + i];
-      else dest[j*XDIM + i] = 0;
-      uint16_t dampening = dest[j*XDIM + i] >> 13;
-      if (dampening < dest[j*XDIM + i]) dest[j*XDIM + i] -= dampening;
-      else dest[j*XDIM + i] = 0;
-    }
-  }
+#if STEPS_PER_FRAME > 1
+  rippleStepBlocked(source, dest, xdim, ydim, Water::DAMPENING, OVERFLOW_MODE, STEPS_PER_FRAME, STRIP_WIDTH);
+#else
+  if (governor.level == 0) Water::step<OVERFLOW_MODE>(source, dest);
+  else CoarseWater::step<OVERFLOW_MODE>(source, dest);
+#endif
   // Randomly moving bullet
   static int offsetX = 0;
   static int offsetY = 0;
@@ -161,18 +220,18 @@ void processWater(uint16_t *source, uint16_t *dest) {
     if (sourceRow < 5) {
       sourceRow = 10;
       directionTimer = 0;
-    } else if (sourceRow > YDIM-6) {
-      sourceRow = YDIM-10;
+    } else if (sourceRow > ydim-6) {
+      sourceRow = ydim-10;
       directionTimer = 0;
     }
     if (sourceCol < 5) {
       sourceCol = 10;
       directionTimer = 0;
-    } else if (sourceCol > XDIM-6) {
-      sourceCol = XDIM-10;
+    } else if (sourceCol > xdim-6) {
+      sourceCol = xdim-10;
       directionTimer = 0;
     }
-    dest[sourceRow*XDIM + sourceCol] = 0xffff;
+    dest[sourceRow*xdim + sourceCol] = 0xffff;
   }
   // Raindrops
   if (rainfallOn && millis() - lastRainfall > rainTimer) {
@@ -180,8 +239,8 @@ void processWater(uint16_t *source, uint16_t *dest) {
     if (repeats < 1) repeats = 1;
     rainTimer = random(10*repeats*DELAY_MILLIS, 30*repeats*DELAY_MILLIS);
     while (repeats > 0) {
-      int row = random(10, XDIM-10);
-      int col = random(10, YDIM-10);
+      int row = random(10, xdim-10);
+      int col = random(10, ydim-10);
       int d = random(-8, 4);
       if (d < -6) d = 0;
       else if (d < 0) d = 1;
@@ -191,7 +250,7 @@ void processWater(uint16_t *source, uint16_t *dest) {
             i += random(-1, 2);
             j += random(-1, 2);
           }
-          dest[j*XDIM + i] = 0xffff;
+          dest[j*xdim + i] = 0xffff;
         }
       }
       repeats--;
@@ -199,3 +258,19 @@ void processWater(uint16_t *source, uint16_t *dest) {
     lastRainfall = millis();
   }
 }
+
+// Moves both fields, the source and the drawing scale to the grid for the governor's level
+void setLevel(int level, uint16_t *p1, uint16_t *p2) {
+  int newX = level ? COARSE_XDIM : XDIM;
+  int newY = level ? COARSE_YDIM : YDIM;
+  rippleResample(p1, xdim, ydim, scratch, newX, newY);
+  memcpy(p1, scratch, newX * newY * sizeof(uint16_t));
+  rippleResample(p2, xdim, ydim, scratch, newX, newY);
+  memcpy(p2, scratch, newX * newY * sizeof(uint16_t));
+  sourceRow = sourceRow * newY / ydim;
+  sourceCol = sourceCol * newX / xdim;
+  xdim = newX;
+  ydim = newY;
+  scale = level ? CoarseWater::SCALE : Water::SCALE;
+  border = 5 * scale / 2;
+}